@@ -0,0 +1,71 @@
+// Copyright (C) 2024 JiDe Zhang <zhangjide@deepin.org>.
+// SPDX-License-Identifier: Apache-2.0 OR LGPL-3.0-only OR GPL-2.0-only OR GPL-3.0-only
+
+#pragma once
+
+#include "wglobal.h"
+
+#include <QInputEvent>
+#include <QVarLengthArray>
+
+WAYLIB_SERVER_BEGIN_NAMESPACE
+
+// The states of the input events in delivery of a WSeat. The before and after
+// dispose stages of an event are paired and the nested events are finished
+// before the outer event, so the states are a stack and the event in delivery
+// is almost always on the top. No memory allocation unless the events are
+// nested deeper than the prealloc size.
+class Q_DECL_HIDDEN WInputEventStates
+{
+public:
+    struct State {
+        // Don't use it, its may be a invalid pointer
+        const void *event;
+        quint64 timestamp;
+        // ###: It's only using compare pointer value.
+        // It's for a Qt bug. When handling mouse events in QQuickDeliveryAgentPrivate::deliverPressOrReleaseEvent,
+        // if there are multiple QQuickItems that can receive the mouse events where the mouse is pressed, Qt will
+        // attempt to dispatch them one by one. Even if the top-level QQuickItem has already accepted the event,
+        // QQuickDeliveryAgentPrivate will still call setAccepted(false) to set the acceptance status to false for
+        // each mouse point in the QPointerEvent. Then it will try to pass the event to the QQuickPointerHandler
+        // objects of the underlying QQuickItems for processing. Although no QQuickPointerHandler receives the event,
+        // the above behavior has already caused QPointerEvent::allPointsAccepted to return false. This will cause
+        // QQuickDeliveryAgentPrivate::deliverPressOrReleaseEvent to return false, ultimately causing
+        // QQuickDeliveryAgentPrivate::deliverPointerEvent to believe that the event has not been accepted and set the
+        // accepted status of QEvent to false. This leads to WSeat considering the event unused, and then it is passed
+        // to WSeatEventFilter::unacceptedEvent.
+        bool isAccepted;
+    };
+
+    inline State *push(const QInputEvent *event) {
+        Q_ASSERT(!find(event));
+        m_states.append({.event = event, .timestamp = event->timestamp(), .isAccepted = true});
+        return &m_states.last();
+    }
+
+    inline State *find(const QInputEvent *event) {
+        for (qsizetype i = m_states.size() - 1; i >= 0; --i) {
+            State &state = m_states[i];
+            if (state.event == event && state.timestamp == event->timestamp())
+                return &state;
+        }
+        return nullptr;
+    }
+
+    inline void pop(const State *state) {
+        Q_ASSERT(state >= m_states.constData() && state < m_states.constData() + m_states.size());
+        if (Q_LIKELY(state == &m_states.last()))
+            m_states.removeLast();
+        else
+            m_states.remove(state - m_states.constData());
+    }
+
+    inline qsizetype size() const {
+        return m_states.size();
+    }
+
+private:
+    QVarLengthArray<State, 8> m_states;
+};
+
+WAYLIB_SERVER_END_NAMESPACE
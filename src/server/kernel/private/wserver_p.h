@@ -37,6 +37,11 @@ public:
 
     std::unique_ptr<QW_NAMESPACE::qw_display> display;
     wl_event_loop *loop = nullptr;
+    // The events are flushed in aboutToBlock since the last awake
+    bool flushedBeforeBlock = false;
+    // The count of the interfaces adding the wl_event_source_check sources,
+    // the event loop is dispatched before blocking if it's not zero
+    int checkSourceUsers = 0;
 
     QList<WSocket*> sockets;
 
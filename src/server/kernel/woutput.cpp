@@ -409,6 +409,23 @@ bool WOutput::configurePrimarySwapchain(const QSize &size, uint32_t format,
     return true;
 }
 
+uint32_t WOutput::pickFormat(const QList<uint32_t> &formats) const
+{
+    auto output = nativeHandle();
+    const wlr_drm_format_set *displayFormats =
+        wlr_output_get_primary_formats(output, output->allocator->buffer_caps);
+
+    for (uint32_t f : formats) {
+        wlr_drm_format format = {0};
+        if (!output_pick_format(output, displayFormats, &format, f))
+            continue;
+        wlr_drm_format_finish(&format);
+        return f;
+    }
+
+    return DRM_FORMAT_INVALID;
+}
+
 bool WOutput::configureCursorSwapchain(const QSize &size, uint32_t drmFormat, qw_swapchain **swapchain)
 {
     Q_ASSERT(!size.isEmpty());
@@ -75,6 +75,10 @@ public:
                                    bool doTest = true);
     bool configureCursorSwapchain(const QSize &size, uint32_t format,
                                   QW_NAMESPACE::qw_swapchain **swapchain);
+    // Returns the first format of the list that can be rendered by the
+    // renderer and displayed by the output, returns DRM_FORMAT_INVALID(0)
+    // if not found.
+    uint32_t pickFormat(const QList<uint32_t> &formats) const;
 
     QW_NAMESPACE::qw_output *handle() const;
     wlr_output *nativeHandle() const;
@@ -7,8 +7,11 @@
 #include "woutput.h"
 #include "wsurface.h"
 #include "wxdgsurface.h"
+#include "wsurfaceitem.h"
+#include "wsurfacehitindex_p.h"
 #include "platformplugin/qwlrootsintegration.h"
 #include "private/wglobal_p.h"
+#include "private/winputeventstates_p.h"
 
 #include <qwseat.h>
 #include <qwkeyboard.h>
@@ -19,18 +22,27 @@
 #include <qwcompositor.h>
 #include <qwdisplay.h>
 #include <qwprimaryselection.h>
+#include <qwoutput.h>
+#include <qwoutputlayout.h>
 
 #include <QQuickWindow>
 #include <QGuiApplication>
 #include <QQuickItem>
 #include <QDebug>
 #include <QTimer>
+#include <QScreen>
+#include <QMetaEnum>
+#include <QScopeGuard>
+#include <QSet>
+#include <QtMath>
 
 #include <qpa/qwindowsysteminterface.h>
 #include <private/qxkbcommon_p.h>
 #include <private/qquickwindow_p.h>
 #include <private/qquickdeliveryagent_p_p.h>
 
+#include <bit>
+
 QT_BEGIN_NAMESPACE
 Q_GUI_EXPORT bool qt_sendShortcutOverrideEvent(QObject *o, ulong timestamp, int k, Qt::KeyboardModifiers mods, const QString &text = QString(), bool autorep = false, ushort count = 1);
 QT_END_NAMESPACE
@@ -74,6 +86,21 @@ protected:
 };
 #endif
 
+inline static qint64 monotonicTimeUsec()
+{
+    timespec time;
+    clock_gettime(CLOCK_MONOTONIC, &time);
+    return time.tv_sec * 1000000ll + time.tv_nsec / 1000;
+}
+
+// The time of the input events is in milliseconds of the CLOCK_MONOTONIC,
+// truncated to 32 bits.
+inline static qint64 eventTimeUsec(uint32_t timestamp, qint64 now)
+{
+    const qint64 nowMsec = now / 1000;
+    return (nowMsec - quint32(quint32(nowMsec) - timestamp)) * 1000;
+}
+
 class Q_DECL_HIDDEN WSeatPrivate : public WWrapObjectPrivate
 {
 public:
@@ -81,7 +108,11 @@ public:
         : WWrapObjectPrivate(qq)
         , name(name)
     {
-        pendingEvents.reserve(2);
+        motionTimer.setSingleShot(true);
+        motionTimer.setTimerType(Qt::PreciseTimer);
+        motionTimer.callOnTimeout([this] {
+            flushPendingMotion();
+        });
 
         m_repeatTimer.callOnTimeout([&](){
             if (!focusWindow) {
@@ -139,10 +170,18 @@ public:
             }
         }
 
+        // The coalesced motion has been sent to this surface by relayMotion
+        if (Q_UNLIKELY(relayedMotionTarget) && relayedMotionTarget == eventObject
+            && pointerFocusEventObject == eventObject) {
+            return true;
+        }
+
+        traceLatency(WSeat::ClientNotifyStage);
         handle()->pointer_notify_motion(timestamp, localPos.x(), localPos.y());
         return true;
     }
     inline bool doNotifyButton(uint32_t button, wl_pointer_button_state state, uint32_t timestamp) {
+        traceLatency(WSeat::ClientNotifyStage);
         handle()->pointer_notify_button(timestamp, button, state);
         return true;
     }
@@ -156,6 +195,7 @@ public:
         if (!pointerFocusSurface())
             return false;
 
+        traceLatency(WSeat::ClientNotifyStage);
         handle()->pointer_notify_axis(timestamp, fromQtHorizontal(orientation), delta, delta_discrete,
                                       source, relative_direction);
         return true;
@@ -290,6 +330,7 @@ public:
             return false;
 
         q_func()->setKeyboard(device);
+        traceLatency(WSeat::ClientNotifyStage);
         /* Send modifiers to the client. */
         this->handle()->keyboard_notify_key(timestamp, keycode, state);
         return true;
@@ -319,6 +360,37 @@ public:
             QCoreApplication::sendEvent(w, &e);
     }
 
+    // for motion coalescing
+    bool relayMotion(WCursor *cursor, uint32_t timestamp);
+    void schedulePendingMotion(WCursor *cursor, const QPointingDevice *device, uint32_t timestamp);
+    void flushPendingMotion();
+    inline void dropPendingMotion() {
+        motionTimer.stop();
+        pendingMotion = {};
+        relayedMotionTarget = nullptr;
+    }
+
+    // for latency tracing
+    inline void beginLatencyTrace(WInputDevice *device, uint32_t timestamp) {
+        if (Q_LIKELY(!latencyTracing))
+            return;
+
+        const qint64 now = monotonicTimeUsec();
+        latencyTrace = {device, eventTimeUsec(timestamp, now), 0};
+        recordLatency(device, WSeat::ReceiveStage, now - latencyTrace.eventTime);
+    }
+    inline void traceLatency(WSeat::LatencyStage stage) {
+        // Only record the first time for the nested events
+        if (Q_LIKELY(!latencyTrace.device) || (latencyTrace.stages & (1u << stage)))
+            return;
+
+        latencyTrace.stages |= 1u << stage;
+        recordLatency(latencyTrace.device, stage, monotonicTimeUsec() - latencyTrace.eventTime);
+    }
+    void endLatencyTrace();
+    void finishPresentTrace();
+    void recordLatency(WInputDevice *device, WSeat::LatencyStage stage, qint64 latency);
+
     // begin slot function
     void on_destroy();
     void on_request_set_cursor(wlr_seat_pointer_request_set_cursor_event *event);
@@ -337,6 +409,11 @@ public:
     void detachInputDevice(WInputDevice *device);
     // handle spontaneous & synthetic key event for focusWindow
     void handleKeyEvent(QKeyEvent &e);
+    // for keyboard fast path
+    bool canSendKeyDirectly(uint32_t code, xkb_keysym_t sym, bool pressed) const;
+    static inline quint64 shortcutKey(Qt::KeyboardModifiers modifiers, xkb_keysym_t sym) {
+        return (quint64(modifiers.toInt()) << 32) | xkb_keysym_to_lower(sym);
+    }
 
     W_DECLARE_PUBLIC(WSeat)
 
@@ -356,42 +433,7 @@ public:
     int gestureFingers = 0;
     qreal lastScale = 1.0;
 
-    struct EventState {
-        // Don't use it, its may be a invalid pointer
-        void *event;
-        quint64 timestamp;
-        // ###: It's only using compare pointer value.
-        // It's for a Qt bug. When handling mouse events in QQuickDeliveryAgentPrivate::deliverPressOrReleaseEvent,
-        // if there are multiple QQuickItems that can receive the mouse events where the mouse is pressed, Qt will
-        // attempt to dispatch them one by one. Even if the top-level QQuickItem has already accepted the event,
-        // QQuickDeliveryAgentPrivate will still call setAccepted(false) to set the acceptance status to false for
-        // each mouse point in the QPointerEvent. Then it will try to pass the event to the QQuickPointerHandler
-        // objects of the underlying QQuickItems for processing. Although no QQuickPointerHandler receives the event,
-        // the above behavior has already caused QPointerEvent::allPointsAccepted to return false. This will cause
-        // QQuickDeliveryAgentPrivate::deliverPressOrReleaseEvent to return false, ultimately causing
-        // QQuickDeliveryAgentPrivate::deliverPointerEvent to believe that the event has not been accepted and set the
-        // accepted status of QEvent to false. This leads to WSeat considering the event unused, and then it is passed
-        // to WSeatEventFilter::unacceptedEvent.
-        bool isAccepted;
-    };
-    QList<EventState> pendingEvents;
-
-    inline EventState *addEventState(QInputEvent *event) {
-        Q_ASSERT(indexOfEventState(event) < 0);
-        pendingEvents.append({.event = event, .timestamp = event->timestamp(), .isAccepted = true});
-        return &pendingEvents.last();
-    }
-    inline int indexOfEventState(QInputEvent *event) const {
-        for (int i = 0; i < pendingEvents.size(); ++i)
-            if (pendingEvents.at(i).event == event
-                    && pendingEvents.at(i).timestamp == event->timestamp())
-                return i;
-        return -1;
-    }
-    inline EventState *getEventState(QInputEvent *event) {
-        int index = indexOfEventState(event);
-        return index < 0 ? nullptr : &pendingEvents[index];
-    }
+    WInputEventStates pendingEvents;
 
     // for event data
     Qt::KeyboardModifiers keyModifiers = Qt::NoModifier;
@@ -411,6 +453,11 @@ public:
     // for keyboard event
     QTimer m_repeatTimer;
     std::unique_ptr<QKeyEvent> m_repeatKey;
+    // The keys pressed through the fast path, by the xkb keycode
+    QList<uint32_t> directPressedKeys;
+    bool keyboardFastPath = false;
+    Qt::KeyboardModifiers shortcutModifiers = Qt::MetaModifier;
+    QSet<quint64> shortcutKeys;
 
     // for cursor data
     // TODO: make to QWSeatClient in wlroots
@@ -423,6 +470,37 @@ public:
     QPointer<WSurface> dragSurface;
 
     bool alwaysUpdateHoverTarget = false;
+
+    // for motion coalescing
+    bool motionCoalescing = false;
+    struct PendingMotion {
+        WCursor *cursor = nullptr;
+        const QPointingDevice *device = nullptr;
+        uint32_t timestamp = 0;
+    } pendingMotion;
+    // Only compare the pointer value
+    QObject *relayedMotionTarget = nullptr;
+    QTimer motionTimer;
+
+    // for latency tracing
+    bool latencyTracing = false;
+    struct LatencyTrace {
+        WInputDevice *device = nullptr;
+        // In microseconds of the CLOCK_MONOTONIC
+        qint64 eventTime = 0;
+        quint32 stages = 0;
+    } latencyTrace;
+    // Only the oldest event waits for the presentation
+    struct PresentTrace {
+        QPointer<WInputDevice> device;
+        QPointer<WOutput> output;
+        qint64 eventTime = 0;
+        bool committed = false;
+        QMetaObject::Connection commitConnection;
+        QMetaObject::Connection presentConnection;
+    } presentTrace;
+    WSeat::InputLatency seatLatency;
+    QHash<WInputDevice*, WSeat::InputLatency> deviceLatency;
 };
 
 void WSeatPrivate::on_destroy()
@@ -430,6 +508,113 @@ void WSeatPrivate::on_destroy()
     q_func()->m_handle = nullptr;
 }
 
+bool WSeatPrivate::relayMotion(WCursor *cursor, uint32_t timestamp)
+{
+    // The implicit grab of the buttons, drag and the interactive move/resize in
+    // event filter need every motion through Qt, don't coalesce them.
+    if (cursor->state() != Qt::NoButton || nativeHandle()->drag)
+        return false;
+
+    auto item = qobject_cast<QQuickItem*>(pointerFocusEventObject.data());
+    if (!item || !pointerFocusSurface() || !item->isVisible())
+        return false;
+
+    QQuickWindow *w = item->window();
+    if (!w || cursor->eventWindow() != w)
+        return false;
+
+    QPointF local;
+    // The pointer leaves the focus surface or enters a surface or a QML item
+    // accepting the pointer events stacked above it, Qt Quick needs to pick
+    // the new target
+    if (WSurfaceHitIndex::get(w)->itemAt(cursor->position() - QPointF(w->position()), &local) != item)
+        return false;
+
+    traceLatency(WSeat::ClientNotifyStage);
+    handle()->pointer_notify_motion(timestamp, local.x(), local.y());
+    relayedMotionTarget = item;
+    return true;
+}
+
+void WSeatPrivate::schedulePendingMotion(WCursor *cursor, const QPointingDevice *device, uint32_t timestamp)
+{
+    pendingMotion = {cursor, device, timestamp};
+    if (motionTimer.isActive())
+        return;
+
+    // Deliver to Qt Quick once per frame of the output under the cursor
+    const QScreen *screen = QGuiApplication::screenAt(cursor->position().toPoint());
+    const qreal refreshRate = screen && screen->refreshRate() > 0 ? screen->refreshRate() : 60;
+    motionTimer.start(qMax(1, qRound(1000 / refreshRate)));
+}
+
+void WSeatPrivate::endLatencyTrace()
+{
+    if (Q_LIKELY(!latencyTrace.device))
+        return;
+
+    const auto trace = std::exchange(latencyTrace, {});
+    if (presentTrace.output || !cursor || !cursor->layout())
+        return;
+
+    const QPointF pos = cursor->position();
+    auto output = cursor->layout()->handle()->output_at(pos.x(), pos.y());
+    WOutput *woutput = output ? WOutput::fromHandle(qw_output::from(output)) : nullptr;
+    if (!woutput)
+        return;
+
+    presentTrace.device = trace.device;
+    presentTrace.output = woutput;
+    presentTrace.eventTime = trace.eventTime;
+    presentTrace.committed = false;
+    presentTrace.commitConnection = QObject::connect(woutput, &WOutput::bufferCommitted, q_func(), [this] {
+        presentTrace.committed = true;
+    });
+    presentTrace.presentConnection = QObject::connect(woutput->handle(), &qw_output::notify_present,
+                                                      q_func(), [this] (wlr_output_event_present *event) {
+        // It's the presentation of the frame before the event
+        if (!presentTrace.committed)
+            return;
+
+        if (event->presented) {
+#if WLR_VERSION_MINOR > 17
+            const timespec &when = event->when;
+#else
+            const timespec &when = *event->when;
+#endif
+            const qint64 presentTime = when.tv_sec * 1000000ll + when.tv_nsec / 1000;
+            recordLatency(presentTrace.device, WSeat::PresentStage, presentTime - presentTrace.eventTime);
+        }
+
+        finishPresentTrace();
+    });
+}
+
+void WSeatPrivate::finishPresentTrace()
+{
+    QObject::disconnect(presentTrace.commitConnection);
+    QObject::disconnect(presentTrace.presentConnection);
+    presentTrace = {};
+}
+
+void WSeatPrivate::recordLatency(WInputDevice *device, WSeat::LatencyStage stage, qint64 latency)
+{
+    seatLatency[stage].add(latency);
+    if (device)
+        deviceLatency[device][stage].add(latency);
+}
+
+void WSeatPrivate::flushPendingMotion()
+{
+    motionTimer.stop();
+    if (!pendingMotion.cursor)
+        return;
+
+    const auto motion = std::exchange(pendingMotion, {});
+    doMouseMove(motion.cursor, motion.device, motion.timestamp);
+    relayedMotionTarget = nullptr;
+}
+
 void WSeatPrivate::on_request_set_cursor(wlr_seat_pointer_request_set_cursor_event *event)
 {
     auto focused_client = nativeHandle()->pointer_state.focused_client;
@@ -517,6 +702,60 @@ void WSeatPrivate::handleKeyEvent(QKeyEvent &e)
     }
     QCoreApplication::sendEvent(focusWindow, &e);
 }
+static Qt::KeyboardModifiers keysymToModifier(xkb_keysym_t sym)
+{
+    switch (sym) {
+    case XKB_KEY_Shift_L:
+    case XKB_KEY_Shift_R:
+        return Qt::ShiftModifier;
+    case XKB_KEY_Control_L:
+    case XKB_KEY_Control_R:
+        return Qt::ControlModifier;
+    case XKB_KEY_Alt_L:
+    case XKB_KEY_Alt_R:
+        return Qt::AltModifier;
+    case XKB_KEY_Super_L:
+    case XKB_KEY_Super_R:
+    case XKB_KEY_Meta_L:
+    case XKB_KEY_Meta_R:
+    case XKB_KEY_Hyper_L:
+    case XKB_KEY_Hyper_R:
+        return Qt::MetaModifier;
+    case XKB_KEY_ISO_Level3_Shift:
+    case XKB_KEY_Mode_switch:
+        return Qt::GroupSwitchModifier;
+    default:
+        return Qt::NoModifier;
+    }
+}
+
+bool WSeatPrivate::canSendKeyDirectly(uint32_t code, xkb_keysym_t sym, bool pressed) const
+{
+    // The release must go the same way as the press, even if the fast path
+    // is disabled or the focus is changed after the press.
+    if (!pressed)
+        return directPressedKeys.contains(code);
+    if (Q_LIKELY(!keyboardFastPath) || !keyboardFocusSurface())
+        return false;
+
+    // The modifiers are updated after the key event, so the press of a
+    // shortcut modifier itself isn't in the keyModifiers yet.
+    if ((keyModifiers | keysymToModifier(sym)) & shortcutModifiers)
+        return false;
+    if (!shortcutKeys.isEmpty() && shortcutKeys.contains(shortcutKey(keyModifiers, sym)))
+        return false;
+
+    // Only if the active focus item of Qt Quick is the event item of the
+    // keyboard focus surface, otherwise a QML item may need the key.
+    auto window = qobject_cast<QQuickWindow*>(focusWindow.data());
+    QQuickItem *item = window ? window->activeFocusItem() : nullptr;
+    auto surfaceItem = item ? qobject_cast<WSurfaceItem*>(item->parentItem()) : nullptr;
+    if (!surfaceItem || surfaceItem->eventItem() != item || !surfaceItem->surface())
+        return false;
+
+    return surfaceItem->surface()->handle()->handle() == keyboardFocusSurface();
+}
+
 void WSeatPrivate::on_keyboard_key(wlr_keyboard_key_event *event, WInputDevice *device)
 {
     auto keyboard = qobject_cast<qw_keyboard*>(device->handle());
@@ -524,6 +763,26 @@ void WSeatPrivate::on_keyboard_key(wlr_keyboard_key_event *event, WInputDevice *
     auto code = event->keycode + 8; // map to wl_keyboard::keymap_format::keymap_format_xkb_v1
     auto et = event->state == WL_KEYBOARD_KEY_STATE_PRESSED ? QEvent::KeyPress : QEvent::KeyRelease;
     xkb_keysym_t sym = xkb_state_key_get_one_sym(keyboard->handle()->xkb_state, code);
+
+    beginLatencyTrace(device, event->time_msec);
+    auto endTrace = qScopeGuard([this] {
+        endLatencyTrace();
+    });
+
+    if (canSendKeyDirectly(code, sym, et == QEvent::KeyPress)) {
+        // The client repeats the key by itself
+        if (m_repeatKey) {
+            m_repeatTimer.stop();
+            m_repeatKey.reset();
+        }
+        if (et == QEvent::KeyPress)
+            directPressedKeys.append(code);
+        else
+            directPressedKeys.removeOne(code);
+        doNotifyKey(device, event->keycode, event->state, event->time_msec);
+        return;
+    }
+
     int qtkey = QXkbCommon::keysymToQtKey(sym, keyModifiers, keyboard->handle()->xkb_state, code);
     const QString &text = QXkbCommon::lookupString(keyboard->handle()->xkb_state, code);
 
@@ -648,6 +907,8 @@ void WSeatPrivate::detachInputDevice(WInputDevice *device)
         touchDeviceList.removeOne(device);
     }
 
+    deviceLatency.remove(device);
+
     [[maybe_unused]] bool ok = QWlrootsIntegration::instance()->removeInputDevice(device);
     Q_ASSERT(ok);
 }
@@ -719,6 +980,7 @@ void WSeat::setCursorPosition(const QPointF &pos)
         return;
 
     cursor()->setPosition(pos);
+    d->dropPendingMotion();
     d->doMouseMove(cursor(), QPointingDevice::primaryPointingDevice(), QDateTime::currentMSecsSinceEpoch());
 }
 
@@ -729,6 +991,7 @@ bool WSeat::setCursorPositionWithChecker(const QPointF &pos)
         return false;
 
     bool ok = cursor()->setPositionWithChecker(pos);
+    d->dropPendingMotion();
     d->doMouseMove(cursor(), QPointingDevice::primaryPointingDevice(), QDateTime::currentMSecsSinceEpoch());
     return ok;
 }
@@ -819,9 +1082,10 @@ bool WSeat::sendEvent(WSurface *target, QObject *shellObject, QObject *eventObje
     auto seat = inputDevice->seat();
     auto d = seat->d_func();
 
-    auto eventState = d->getEventState(event);
+    auto eventState = d->pendingEvents.find(event);
     if (eventState)
         eventState->isAccepted = true;
+    d->traceLatency(SeatDispatchStage);
 
     if (shellObject && d->eventFilter && d->eventFilter->beforeHandleEvent(seat, target, shellObject, eventObject, event))
         return true;
@@ -987,6 +1251,19 @@ WSeat *WSeat::get(QInputEvent *event)
     return inputDevice ? inputDevice->seat() : nullptr;
 }
 
+WSurface *WSeat::surfaceAt(const QPointF &position, QPointF *localPos) const
+{
+    W_DC(WSeat);
+    auto window = d->cursor ? qobject_cast<QQuickWindow*>(d->cursor->eventWindow()) : nullptr;
+    if (!window)
+        return nullptr;
+
+    QQuickItem *item = WSurfaceHitIndex::get(window)->itemAt(position - QPointF(window->position()), localPos);
+    // The input item is a child of WSurfaceItem, see EventItem
+    auto surfaceItem = item ? qobject_cast<WSurfaceItem*>(item->parentItem()) : nullptr;
+    return surfaceItem ? surfaceItem->surface() : nullptr;
+}
+
 WSurface *WSeat::pointerFocusSurface() const
 {
     W_DC(WSeat);
@@ -1100,13 +1377,194 @@ void WSeat::notifyMotion(WCursor *cursor, WInputDevice *device, uint32_t timesta
     W_D(WSeat);
 
     auto qwDevice = static_cast<QPointingDevice*>(device->qtDevice());
-    d->doMouseMove(cursor, qwDevice, timestamp);
+    d->beginLatencyTrace(device, timestamp);
+    if (d->motionCoalescing && d->relayMotion(cursor, timestamp)) {
+        d->schedulePendingMotion(cursor, qwDevice, timestamp);
+    } else {
+        // This motion supersedes the pending one, it has been sent to the client
+        d->dropPendingMotion();
+        d->doMouseMove(cursor, qwDevice, timestamp);
+    }
+    d->endLatencyTrace();
+}
+
+bool WSeat::motionCoalescing() const
+{
+    W_DC(WSeat);
+    return d->motionCoalescing;
+}
+
+void WSeat::setMotionCoalescing(bool newMotionCoalescing)
+{
+    W_D(WSeat);
+    if (d->motionCoalescing == newMotionCoalescing)
+        return;
+    d->motionCoalescing = newMotionCoalescing;
+
+    if (!d->motionCoalescing)
+        d->flushPendingMotion();
+
+    Q_EMIT motionCoalescingChanged();
+}
+
+bool WSeat::keyboardFastPath() const
+{
+    W_DC(WSeat);
+    return d->keyboardFastPath;
+}
+
+void WSeat::setKeyboardFastPath(bool newKeyboardFastPath)
+{
+    W_D(WSeat);
+    if (d->keyboardFastPath == newKeyboardFastPath)
+        return;
+    d->keyboardFastPath = newKeyboardFastPath;
+    Q_EMIT keyboardFastPathChanged();
+}
+
+Qt::KeyboardModifiers WSeat::shortcutModifiers() const
+{
+    W_DC(WSeat);
+    return d->shortcutModifiers;
+}
+
+void WSeat::setShortcutModifiers(Qt::KeyboardModifiers newShortcutModifiers)
+{
+    W_D(WSeat);
+    if (d->shortcutModifiers == newShortcutModifiers)
+        return;
+    d->shortcutModifiers = newShortcutModifiers;
+    Q_EMIT shortcutModifiersChanged();
+}
+
+void WSeat::addShortcutKey(Qt::KeyboardModifiers modifiers, quint32 keysym)
+{
+    W_D(WSeat);
+    d->shortcutKeys.insert(WSeatPrivate::shortcutKey(modifiers, keysym));
+}
+
+void WSeat::removeShortcutKey(Qt::KeyboardModifiers modifiers, quint32 keysym)
+{
+    W_D(WSeat);
+    d->shortcutKeys.remove(WSeatPrivate::shortcutKey(modifiers, keysym));
+}
+
+void WSeat::clearShortcutKeys()
+{
+    W_D(WSeat);
+    d->shortcutKeys.clear();
+}
+
+bool WSeat::latencyTracing() const
+{
+    W_DC(WSeat);
+    return d->latencyTracing;
+}
+
+void WSeat::setLatencyTracing(bool newLatencyTracing)
+{
+    W_D(WSeat);
+    if (d->latencyTracing == newLatencyTracing)
+        return;
+    d->latencyTracing = newLatencyTracing;
+
+    if (!d->latencyTracing) {
+        d->latencyTrace = {};
+        d->finishPresentTrace();
+    }
+
+    Q_EMIT latencyTracingChanged();
+}
+
+WSeat::InputLatency WSeat::inputLatency() const
+{
+    W_DC(WSeat);
+    return d->seatLatency;
+}
+
+WSeat::InputLatency WSeat::inputLatency(WInputDevice *device) const
+{
+    W_DC(WSeat);
+    return d->deviceLatency.value(device);
+}
+
+void WSeat::resetInputLatency()
+{
+    W_D(WSeat);
+    d->seatLatency = {};
+    d->deviceLatency.clear();
+}
+
+static QVariantMap inputLatencyToMap(const WSeat::InputLatency &latency)
+{
+    const QMetaEnum stages = QMetaEnum::fromType<WSeat::LatencyStage>();
+    QVariantMap map;
+
+    for (int i = 0; i < WSeat::LatencyStageCount; ++i) {
+        const auto &histogram = latency[i];
+        if (!histogram.count)
+            continue;
+
+        map.insert(QString::fromLatin1(stages.valueToKey(i)), QVariantMap {
+            {QStringLiteral("count"), histogram.count},
+            {QStringLiteral("mean"), histogram.total / qint64(histogram.count)},
+            {QStringLiteral("p50"), histogram.percentile(50)},
+            {QStringLiteral("p99"), histogram.percentile(99)},
+            {QStringLiteral("max"), histogram.max},
+        });
+    }
+
+    return map;
+}
+
+QVariantMap WSeat::inputLatencyMap() const
+{
+    W_DC(WSeat);
+
+    QVariantMap devices;
+    for (auto it = d->deviceLatency.constBegin(); it != d->deviceLatency.constEnd(); ++it) {
+        const QString name = it.key()->qtDevice() ? it.key()->qtDevice()->name() : QString();
+        devices.insert(name, inputLatencyToMap(it.value()));
+    }
+
+    return {
+        {QStringLiteral("seat"), inputLatencyToMap(d->seatLatency)},
+        {QStringLiteral("devices"), devices},
+    };
+}
+
+void WSeat::LatencyHistogram::add(qint64 latency)
+{
+    latency = qMax(latency, 0ll);
+    const int bucket = qMin(int(std::bit_width(quint64(latency))), int(buckets.size()) - 1);
+    ++buckets[bucket];
+    ++count;
+    total += latency;
+    max = qMax(max, latency);
+}
+
+qint64 WSeat::LatencyHistogram::percentile(qreal percent) const
+{
+    if (!count)
+        return 0;
+
+    const quint64 rank = qMax(quint64(1), quint64(qCeil(count * percent / 100)));
+    quint64 n = 0;
+    for (int i = 0; i < int(buckets.size()) - 1; ++i) {
+        n += buckets[i];
+        if (n >= rank)
+            return qMin(1ll << i, max);
+    }
+
+    return max;
 }
 
 void WSeat::notifyButton(WCursor *cursor, WInputDevice *device, Qt::MouseButton button,
                          wl_pointer_button_state_t state, uint32_t timestamp)
 {
     W_D(WSeat);
+    // Qt Quick must see the latest position before this event
+    d->flushPendingMotion();
 
     auto qwDevice = static_cast<QPointingDevice*>(device->qtDevice());
     Q_ASSERT(qwDevice);
@@ -1124,8 +1582,10 @@ void WSeat::notifyButton(WCursor *cursor, WInputDevice *device, Qt::MouseButton
         Q_ASSERT(e.isEndEvent());
     e.setTimestamp(timestamp);
 
+    d->beginLatencyTrace(device, timestamp);
     if (w)
         QCoreApplication::sendEvent(w, &e);
+    d->endLatencyTrace();
 }
 
 void WSeat::notifyAxis(WCursor *cursor, WInputDevice *device, wl_pointer_axis_source_t source,
@@ -1133,6 +1593,7 @@ void WSeat::notifyAxis(WCursor *cursor, WInputDevice *device, wl_pointer_axis_so
                        double delta, int32_t delta_discrete, uint32_t timestamp)
 {
     W_D(WSeat);
+    d->flushPendingMotion();
 
     auto qwDevice = static_cast<QPointingDevice*>(device->qtDevice());
     Q_ASSERT(qwDevice);
@@ -1150,6 +1611,7 @@ void WSeat::notifyAxis(WCursor *cursor, WInputDevice *device, wl_pointer_axis_so
                       Qt::NoScrollPhase, false, Qt::MouseEventNotSynthesized, qwDevice);
     e.setTimestamp(timestamp);
 
+    d->beginLatencyTrace(device, timestamp);
     if (w) {
         QCoreApplication::sendEvent(w, &e);
     } else {
@@ -1157,6 +1619,7 @@ void WSeat::notifyAxis(WCursor *cursor, WInputDevice *device, wl_pointer_axis_so
                         static_cast<wl_pointer_axis_relative_direction>(rd),
                         delta, delta_discrete, timestamp);
     }
+    d->endLatencyTrace();
 }
 
 void WSeat::notifyFrame(WCursor *cursor)
@@ -1169,6 +1632,7 @@ void WSeat::notifyFrame(WCursor *cursor)
 void WSeat::notifyGestureBegin(WCursor *cursor, WInputDevice *device, uint32_t time_msec, uint32_t fingers, WGestureEvent::WLibInputGestureType libInputGestureType)
 {
     W_D(WSeat);
+    d->flushPendingMotion();
     if (d->gestureActive) {
         qCWarning(qLcWlrGestureEvents) << "Unexpected GestureBegin while already active";
     }
@@ -1239,6 +1703,7 @@ void WSeat::notifyGestureEnd(WCursor *cursor, WInputDevice *device, uint32_t tim
 void WSeat::notifyHoldBegin(WCursor *cursor, WInputDevice *device, uint32_t time_msec, uint32_t fingers)
 {
     W_D(WSeat);
+    d->flushPendingMotion();
     if (d->gestureActive) {
         qCWarning(qLcWlrGestureEvents) << "Unexpected HoldBegin while already active";
     }
@@ -1500,7 +1965,8 @@ bool WSeat::filterEventBeforeDisposeStage(QWindow *targetWindow, QInputEvent *ev
 {
     W_D(WSeat);
 
-    d->addEventState(event);
+    d->pendingEvents.push(event);
+    d->traceLatency(QtDeliveryStage);
 
     if (Q_UNLIKELY(d->alwaysUpdateHoverTarget) && event->isPointerEvent()) {
         auto pe = static_cast<QPointerEvent*>(event);
@@ -1554,11 +2020,11 @@ bool WSeat::filterEventAfterDisposeStage(QWindow *targetWindow, QInputEvent *eve
 {
     W_D(WSeat);
 
-    int eventStateIndex = d->indexOfEventState(event);
-    Q_ASSERT(eventStateIndex >= 0);
+    auto eventState = d->pendingEvents.find(event);
+    Q_ASSERT(eventState);
 
-    if (event->isAccepted() || d->pendingEvents.at(eventStateIndex).isAccepted) {
-        d->pendingEvents.removeAt(eventStateIndex);
+    if (event->isAccepted() || eventState->isAccepted) {
+        d->pendingEvents.pop(eventState);
 
         if (Q_UNLIKELY(d->alwaysUpdateHoverTarget) && event->isPointerEvent()) {
             auto pe = static_cast<QPointerEvent*>(event);
@@ -1576,10 +2042,11 @@ bool WSeat::filterEventAfterDisposeStage(QWindow *targetWindow, QInputEvent *eve
         return false;
     }
 
-    d->pendingEvents[eventStateIndex].isAccepted = true;
+    eventState->isAccepted = true;
     bool ok = filterUnacceptedEvent(targetWindow, event);
 
-    d->pendingEvents.removeAt(eventStateIndex);
+    // The nested events in filterUnacceptedEvent may reallocate the states
+    d->pendingEvents.pop(d->pendingEvents.find(event));
 
     return ok;
 }
@@ -9,6 +9,9 @@
 
 #include <QEvent>
 #include <QSharedData>
+#include <QVariantMap>
+
+#include <array>
 
 Q_MOC_INCLUDE(<wsurface.h>)
 
@@ -60,8 +63,45 @@ class WAYLIB_SERVER_EXPORT WSeat : public WWrapObject, public WServerInterface
     Q_PROPERTY(WInputDevice* keyboard READ keyboard WRITE setKeyboard NOTIFY keyboardChanged FINAL)
     Q_PROPERTY(WSurface* keyboardFocus READ keyboardFocusSurface WRITE setKeyboardFocusSurface NOTIFY keyboardFocusSurfaceChanged FINAL)
     Q_PROPERTY(bool alwaysUpdateHoverTarget READ alwaysUpdateHoverTarget WRITE setAlwaysUpdateHoverTarget NOTIFY alwaysUpdateHoverTargetChanged FINAL)
+    Q_PROPERTY(bool motionCoalescing READ motionCoalescing WRITE setMotionCoalescing NOTIFY motionCoalescingChanged FINAL)
+    Q_PROPERTY(bool latencyTracing READ latencyTracing WRITE setLatencyTracing NOTIFY latencyTracingChanged FINAL)
+    Q_PROPERTY(bool keyboardFastPath READ keyboardFastPath WRITE setKeyboardFastPath NOTIFY keyboardFastPathChanged FINAL)
+    Q_PROPERTY(Qt::KeyboardModifiers shortcutModifiers READ shortcutModifiers WRITE setShortcutModifiers NOTIFY shortcutModifiersChanged FINAL)
 
 public:
+    // The latency of a stage is from the time of the event reported by the
+    // input device to the time the event reaches the stage, the time of the
+    // input device is in milliseconds, so the latencies have an error of 1ms.
+    enum LatencyStage {
+        // WSeat receives the event from the backend
+        ReceiveStage,
+        // Qt delivers the event to the window
+        QtDeliveryStage,
+        // The event item of the surface sends the event to WSeat
+        SeatDispatchStage,
+        // The event is sent to the client by wlr_seat_*_notify_*
+        ClientNotifyStage,
+        // The first frame committed after the event on the output under the
+        // cursor is presented, the response of the client may be in a later frame
+        PresentStage,
+        LatencyStageCount
+    };
+    Q_ENUM(LatencyStage)
+
+    // The latencies are in microseconds, the bucket i counts the latencies
+    // in [2^(i-1), 2^i), the last bucket has no upper bound.
+    struct LatencyHistogram {
+        std::array<quint64, 24> buckets = {};
+        quint64 count = 0;
+        qint64 total = 0;
+        qint64 max = 0;
+
+        void add(qint64 latency);
+        // Returns the upper bound of the bucket containing the percentile
+        qint64 percentile(qreal percent) const;
+    };
+    using InputLatency = std::array<LatencyHistogram, LatencyStageCount>;
+
     WSeat(const QString &name = QStringLiteral("seat0"));
 
     static WSeat *fromHandle(const QW_NAMESPACE::qw_seat *handle);
@@ -89,6 +129,11 @@ public:
     WSeatEventFilter *eventFilter() const;
     void setEventFilter(WSeatEventFilter *filter);
 
+    // Find the surface and the position in the surface at the global position,
+    // by the input regions of the WSurfaceItem in the event window of the cursor.
+    // It doesn't walk the Qt Quick item tree, but it may be one frame late.
+    // Returns nullptr if an item accepting the pointer events is above the surface.
+    WSurface *surfaceAt(const QPointF &position, QPointF *localPos = nullptr) const;
     WSurface *pointerFocusSurface() const;
 
     void setKeyboardFocusSurface(WSurface *surface);
@@ -105,6 +150,40 @@ public:
     bool alwaysUpdateHoverTarget() const;
     void setAlwaysUpdateHoverTarget(bool newIgnoreSurfacePointerEventExclusiveGrabber);
 
+    // If enabled, the pointer motion inside the current pointer focus surface is
+    // sent to the client directly with the original timestamp, and the QMouseEvent
+    // for Qt Quick (hit-testing, hover, event filter) is delivered at most once per
+    // output frame with the latest position. The motion with buttons pressed or
+    // during drag, and the motion leaving the focus surface, are not coalesced.
+    bool motionCoalescing() const;
+    void setMotionCoalescing(bool newMotionCoalescing);
+
+    // If enabled, the keys are sent to the keyboard focus surface directly
+    // without QKeyEvent, when the active focus item of Qt Quick is the event
+    // item of the surface. The keys with any of the shortcutModifiers, the
+    // keys of the shortcutModifiers, and the keys added by addShortcutKey
+    // always go through Qt for the shortcuts of the compositor, the
+    // WSeatEventFilter doesn't see the other keys. A key release always goes
+    // the same way as its press.
+    bool keyboardFastPath() const;
+    void setKeyboardFastPath(bool newKeyboardFastPath);
+    Qt::KeyboardModifiers shortcutModifiers() const;
+    void setShortcutModifiers(Qt::KeyboardModifiers newShortcutModifiers);
+    // The keysym is the xkb_keysym_t, it's case insensitive
+    void addShortcutKey(Qt::KeyboardModifiers modifiers, quint32 keysym);
+    void removeShortcutKey(Qt::KeyboardModifiers modifiers, quint32 keysym);
+    void clearShortcutKeys();
+
+    // Trace the pointer motion, button, axis and keyboard key events
+    bool latencyTracing() const;
+    void setLatencyTracing(bool newLatencyTracing);
+    InputLatency inputLatency() const;
+    InputLatency inputLatency(WInputDevice *device) const;
+    void resetInputLatency();
+    // The count, mean, p50, p99 and max of the stages, for the seat and for
+    // each device by the name of the device
+    Q_INVOKABLE QVariantMap inputLatencyMap() const;
+
 Q_SIGNALS:
     void keyboardChanged();
     void keyboardFocusSurfaceChanged();
@@ -112,6 +191,10 @@ Q_SIGNALS:
     void requestCursorSurface(WAYLIB_SERVER_NAMESPACE::WSurface *surface, const QPoint &hotspot);
     void requestDrag(WAYLIB_SERVER_NAMESPACE::WSurface *surface);
     void alwaysUpdateHoverTargetChanged();
+    void motionCoalescingChanged();
+    void latencyTracingChanged();
+    void keyboardFastPathChanged();
+    void shortcutModifiersChanged();
 
 protected:
     using QObject::eventFilter;
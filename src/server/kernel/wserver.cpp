@@ -104,6 +104,9 @@ void WServerPrivate::init()
     loop = wl_display_get_event_loop(display->handle());
     int fd = wl_event_loop_get_fd(loop);
 
+    // The fd of wl_event_loop is an epoll fd, all the wayland sources (clients,
+    // timers and signals) are in it, so the wayland events are polled by the
+    // Qt event dispatcher in the same poll of the Qt's fds.
     auto processWaylandEvents = [this] {
         int ret = wl_event_loop_dispatch(loop, 0);
         if (ret)
@@ -114,8 +117,37 @@ void WServerPrivate::init()
     sockNot.reset(new QSocketNotifier(fd, QSocketNotifier::Read));
     QObject::connect(sockNot.get(), &QSocketNotifier::activated, q, processWaylandEvents);
 
+    // Run the idle sources added in this loop turn and send the events queued
+    // by the Qt side. The fd sources are not dispatched here, the socket notifier
+    // does it if they're ready, the epoll_wait of the wl_event_loop_dispatch is
+    // a waste of syscall in every loop turn. And wl_display_flush_clients only
+    // writes the clients having queued events.
+    auto dispatchIdleAndFlush = [this] {
+        wl_event_loop_dispatch_idle(loop);
+        wl_display_flush_clients(display->handle());
+    };
+
     QAbstractEventDispatcher *dispatcher = QThread::currentThread()->eventDispatcher();
-    QObject::connect(dispatcher, &QAbstractEventDispatcher::aboutToBlock, q, processWaylandEvents);
+    QObject::connect(dispatcher, &QAbstractEventDispatcher::aboutToBlock, q, [this, dispatchIdleAndFlush, processWaylandEvents] {
+        // The sources using wl_event_source_check (e.g. the X11 fd of the xwm)
+        // are only checked in wl_event_loop_dispatch, their queued events (e.g.
+        // the xcb events read by other xcb calls) don't wake up the epoll fd,
+        // keep a real dispatch while they exist.
+        if (checkSourceUsers > 0)
+            processWaylandEvents();
+        else
+            dispatchIdleAndFlush();
+        flushedBeforeBlock = true;
+    });
+    // The dispatcher doesn't block if there are always posted events, e.g. the
+    // QML is busy, then aboutToBlock is never emitted. Flush the events queued in
+    // the last loop turn (e.g. the frame callbacks sent after rendering) when the
+    // next turn begins, don't let the clients wait for the idle of the compositor.
+    // Only if the last turn didn't flush before blocking, once per loop turn.
+    QObject::connect(dispatcher, &QAbstractEventDispatcher::awake, q, [this, dispatchIdleAndFlush] {
+        if (!std::exchange(flushedBeforeBlock, false))
+            dispatchIdleAndFlush();
+    });
 
     for (auto socket : std::as_const(sockets))
         initSocket(socket);
@@ -6,6 +6,7 @@
 #include "wseat.h"
 #include "wsocket.h"
 #include "private/wglobal_p.h"
+#include "private/wserver_p.h"
 
 #include <qwseat.h>
 #include <qwxwayland.h>
@@ -327,6 +328,8 @@ void WXWayland::create(WServer *server)
     initHandle(handle);
     m_handle = handle;
     d->socket->bind(handle->handle()->server->x_fd[1]);
+    // The xwm checks its X11 fd by wl_event_source_check
+    ++static_cast<WServerPrivate*>(WObjectPrivate::get(server))->checkSourceUsers;
 
     QObject::connect(handle, &qw_xwayland::notify_new_surface, this, [d] (wlr_xwayland_surface *surface) {
         d->on_new_surface(surface);
@@ -345,8 +348,8 @@ void WXWayland::create(WServer *server)
 
 void WXWayland::destroy(WServer *server)
 {
-    Q_UNUSED(server);
     W_D(WXWayland);
+    --static_cast<WServerPrivate*>(WObjectPrivate::get(server))->checkSourceUsers;
 
     auto list = d->surfaceList;
     d->surfaceList.clear();
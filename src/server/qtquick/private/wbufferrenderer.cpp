@@ -4,8 +4,9 @@
 #include "wbufferrenderer_p.h"
 #include "wrenderhelper.h"
 #include "wqmlhelper_p.h"
-#include "wtools.h"
 #include "wsgtextureprovider.h"
+#include "wsgdamagecollector_p.h"
+#include "wpixmanregion_p.h"
 
 #include <qwbuffer.h>
 #include <qwtexture.h>
@@ -33,6 +34,7 @@
 #ifndef QT_NO_OPENGL
 #include <private/qrhigles2_p.h>
 #include <private/qopenglcontext_p.h>
+#include <QOpenGLFunctions>
 #endif
 #include <private/qsgbatchrenderer_p.h>
 
@@ -43,25 +45,15 @@
 QW_USE_NAMESPACE
 WAYLIB_SERVER_BEGIN_NAMESPACE
 
-struct Q_DECL_HIDDEN PixmanRegion
+// The QSGRenderer that has recorded commands to the QRhi's command buffer, and
+// the commands are not finished. The same QSGRenderer can't render again before
+// its commands are finished, because the uniform buffers of the renderer will
+// be overwritten, see WBufferRenderer::render.
+static QHash<const QRhi*, QSet<const QSGRenderer*>> &rhiPendingRenderers()
 {
-    PixmanRegion() {
-        pixman_region32_init(&data);
-    }
-    ~PixmanRegion() {
-        pixman_region32_fini(&data);
-    }
-
-    inline operator pixman_region32_t*() {
-        return &data;
-    }
-
-    inline bool isEmpty() const {
-        return !pixman_region32_not_empty(&data);
-    }
-
-    pixman_region32_t data;
-};
+    static QHash<const QRhi*, QSet<const QSGRenderer*>> renderers;
+    return renderers;
+}
 
 inline static WImageRenderTarget *getImageFrom(const QQuickRenderTarget &rt)
 {
@@ -368,7 +360,6 @@ qw_buffer *WBufferRenderer::beginRender(const QSize &pixelSize, qreal devicePixe
             return nullptr;
     }
 
-    // TODO: Support scanout buffer of wlr_surface(from WSurfaceItem)
     int bufferAge;
     auto wbuffer = m_swapchain->acquire(&bufferAge);
     if (!wbuffer)
@@ -395,14 +386,10 @@ qw_buffer *WBufferRenderer::beginRender(const QSize &pixelSize, qreal devicePixe
         sgRT.paintDevice = rtd->u.paintDevice;
 
         // // For software renderer, update the dirty parts relative to the last paint device.
-        PixmanRegion damage;
+        WPixmanRegion damage;
         m_damageRing.get_buffer_damage(bufferAge, damage);
-        state.dirty = WTools::fromPixmanRegion(damage);
-
-        if (devicePixelRatio != 1.0) {
-            state.dirty = QTransform::fromScale(1.0 / devicePixelRatio,
-                                                1.0 / devicePixelRatio).map(state.dirty);
-        }
+        damage.scale(1.0 / devicePixelRatio);
+        state.dirty = damage.toRegion();
     } else {
         state.dirty = QRegion();
 
@@ -531,40 +518,84 @@ void WBufferRenderer::render(int sourceIndex, const QMatrix4x4 &renderMatrix,
             if (state.renderTarget.mirrorVertically())
                 flipY = !flipY;
 
-            if (viewportRect.isValid()) {
-                QRect vr = viewportRect;
-                if (flipY)
-                    vr.moveTop(-vr.y() + state.pixelSize.height() - vr.height());
-                renderer->setViewportRect(vr);
-            } else {
-                renderer->setViewportRect(QRect(QPoint(0, 0), state.pixelSize));
-            }
-
             QRectF rect = sourceRect;
             if (!rect.isValid())
                 rect = QRectF(QPointF(0, 0), QSizeF(state.pixelSize) / devicePixelRatio);
+            QRect viewport = viewportRect.isValid() ? viewportRect
+                                                    : QRect(QPoint(0, 0), state.pixelSize);
+
+            // Only repaint the damaged area of the current buffer, the other area
+            // is same as the contents of the buffer age. If doesn't preserve color
+            // contents, the damaged area needs clear by clearPaintRect, it's only
+            // supported for OpenGL.
+            static bool noPartialRender = qEnvironmentVariableIsSet("WAYLIB_NO_PARTIAL_RENDER");
+            QRect paintRect = updateDamage(sourceIndex, rect, viewport);
+            const bool canPartialRender = !noPartialRender
+                                          // If has more sources, the other sources maybe
+                                          // will paint to the outside of the paintRect.
+                                          && m_sourceList.size() == 1
+                                          && (preserveColorContents
+                                              || wd->rhi->backend() == QRhi::OpenGLES2);
+            bool needsClear = false;
+
+            if (canPartialRender && paintRect != viewport) {
+                // Keep the renderer to run, some nodes maybe need preprocess
+                if (paintRect.isEmpty())
+                    paintRect = QRect(viewport.topLeft(), QSize(1, 1));
+
+                const qreal xScale = rect.width() / viewport.width();
+                const qreal yScale = rect.height() / viewport.height();
+                rect = QRectF(rect.x() + (paintRect.x() - viewport.x()) * xScale,
+                              rect.y() + (paintRect.y() - viewport.y()) * yScale,
+                              paintRect.width() * xScale, paintRect.height() * yScale);
+                viewport = paintRect;
+                needsClear = !preserveColorContents;
+                preserveColorContents = true;
+            }
 
-            const float left = rect.x();
-            const float right = rect.x() + rect.width();
-            float bottom = rect.y() + rect.height();
-            float top = rect.y();
-
+            QRect vr = viewport;
             if (flipY)
-                std::swap(top, bottom);
-
-            QMatrix4x4 matrix;
-            matrix.ortho(left, right, bottom, top, 1, -1);
+                vr.moveTop(-vr.y() + state.pixelSize.height() - vr.height());
+            renderer->setViewportRect(vr);
+
+            if (needsClear) {
+                state.clearRect = QRect(vr.x(), state.pixelSize.height() - vr.y() - vr.height(),
+                                        vr.width(), vr.height());
+                renderer->setRenderPassRecordingCallbacks(&WBufferRenderer::clearPaintRect,
+                                                          nullptr, this);
+            }
 
-            QMatrix4x4 projectionMatrix, projectionMatrixWithNativeNDC;
-            projectionMatrix = matrix * state.worldTransform;
+            auto ortho = [flipY] (const QRectF &rect, bool nativeNDC) {
+                const float left = rect.x();
+                const float right = rect.x() + rect.width();
+                float bottom = rect.y() + rect.height();
+                float top = rect.y();
 
-            if (wd->rhi && !wd->rhi->isYUpInNDC()) {
-                std::swap(top, bottom);
+                if (flipY != nativeNDC)
+                    std::swap(top, bottom);
 
-                matrix.setToIdentity();
+                QMatrix4x4 matrix;
                 matrix.ortho(left, right, bottom, top, 1, -1);
-            }
-            projectionMatrixWithNativeNDC = matrix * state.worldTransform;
+                return matrix;
+            };
+
+            // The batch renderer computes the scissor of the rectangular clip
+            // nodes by the native NDC matrix and the device rect, it assumes the
+            // viewport is the whole device rect. So the native NDC matrix maps
+            // the area of the whole buffer instead of the viewport, the scissors
+            // are correct if the viewport is a part of the buffer (e.g. the
+            // partial render). The vertices are mapped by the projection matrix.
+            const qreal xScale = rect.width() / viewport.width();
+            const qreal yScale = rect.height() / viewport.height();
+            const QRectF deviceSourceRect(rect.x() - viewport.x() * xScale,
+                                          rect.y() - viewport.y() * yScale,
+                                          state.pixelSize.width() * xScale,
+                                          state.pixelSize.height() * yScale);
+            const bool yUpInNDC = !wd->rhi || wd->rhi->isYUpInNDC();
+
+            QMatrix4x4 projectionMatrix, projectionMatrixWithNativeNDC;
+            projectionMatrix = ortho(rect, false) * state.worldTransform;
+            projectionMatrixWithNativeNDC = ortho(deviceSourceRect, !yUpInNDC) * state.worldTransform;
 
             renderer->setProjectionMatrix(projectionMatrix);
             renderer->setProjectionMatrixWithNativeNDC(projectionMatrixWithNativeNDC);
@@ -578,49 +609,46 @@ void WBufferRenderer::render(int sourceIndex, const QMatrix4x4 &renderMatrix,
         }
     }
 
+    // ###: maybe Qt bug? Before executing QRhi::endOffscreenFrame, we may
+    // use the same QSGRenderer for multiple drawings. This can lead to
+    // rendering the same content for different QSGRhiRenderTarget instances
+    // when using the RhiGles backend. So only wait for the GPU if this renderer
+    // has been used in this frame.
+    if (!softwareRenderer && rhiPendingRenderers().value(wd->rhi).contains(renderer))
+        finishRhiWorks(wd->rhi);
+
     state.context->renderNextFrame(renderer);
 
     { // after render
         if (!softwareRenderer) {
-            // TODO: get damage area from QRhi renderer
-            m_damageRing.add_whole();
-            // ###: maybe Qt bug? Before executing QRhi::endOffscreenFrame, we may
-            // use the same QSGRenderer for multiple drawings. This can lead to
-            // rendering the same content for different QSGRhiRenderTarget instances
-            // when using the RhiGles backend. Additionally, considering that the
-            // result of the current drawing may be needed when drawing the next
-            // sourceIndex, we should let the RHI (Rendering Hardware Interface)
-            // complete the results of this drawing here to ensure the current
-            // drawing result is available for use.
-            wd->rhi->finish();
+            if (!state.clearRect.isNull()) {
+                renderer->setRenderPassRecordingCallbacks(nullptr, nullptr, nullptr);
+                state.clearRect = QRect();
+            }
+            // The later sources of this buffer are recorded to the same command
+            // buffer after this, the RHI will keep the order, don't need to
+            // wait for the GPU here.
+            rhiPendingRenderers()[wd->rhi].insert(renderer);
         } else {
             state.dirty = softwareRenderer->flushRegion();
 
             auto currentImage = getImageFrom(state.renderTarget);
             Q_ASSERT(currentImage && currentImage == softwareRenderer->m_rt.paintDevice);
             currentImage->setDevicePixelRatio(1.0);
-            const auto scaleTF = QTransform::fromScale(devicePixelRatio, devicePixelRatio);
-            const auto scaledFlushRegion = scaleTF.map(softwareRenderer->flushRegion());
-            PixmanRegion scaledFlushDamage;
-            bool ok = WTools::toPixmanRegion(scaledFlushRegion, scaledFlushDamage);
-            Q_ASSERT(ok);
-
-            {
-                PixmanRegion damage;
-                m_damageRing.get_buffer_damage(state.bufferAge, damage);
-
-                if (viewportRect.isValid()) {
-                    QRect imageRect = (currentImage->operator const QImage &()).rect();
-                    QRegion invalidRegion(imageRect);
-                    invalidRegion -= viewportRect;
-                    if (!scaledFlushRegion.isEmpty())
-                        invalidRegion &= scaledFlushRegion;
-
-                    if (!invalidRegion.isEmpty()) {
-                        QPainter pa(currentImage);
-                        for (const auto r : std::as_const(invalidRegion))
-                            pa.fillRect(r, softwareRenderer->clearColor());
-                    }
+            WPixmanRegion scaledFlushDamage(state.dirty);
+            scaledFlushDamage.scale(devicePixelRatio);
+
+            if (viewportRect.isValid()) {
+                QRect imageRect = (currentImage->operator const QImage &()).rect();
+                WPixmanRegion invalidRegion(imageRect);
+                invalidRegion.subtract(viewportRect);
+                if (!scaledFlushDamage.isEmpty())
+                    invalidRegion.intersect(scaledFlushDamage);
+
+                if (!invalidRegion.isEmpty()) {
+                    QPainter pa(currentImage);
+                    for (const auto r : std::as_const(invalidRegion))
+                        pa.fillRect(r, softwareRenderer->clearColor());
                 }
             }
 
@@ -653,8 +681,15 @@ void WBufferRenderer::endRender()
     m_swapchain->set_buffer_submitted(*buffer);
     buffer->unlock();
 
-#ifndef QT_NO_OPENGL
     auto wd = QQuickWindowPrivate::get(window());
+    // The buffer maybe sampled by the later renders in this frame via the texture
+    // provider (e.g. WOutputViewport::depends and the layers composite), but the
+    // texture is another QRhiTexture of the same buffer, the RHI can't know the
+    // dependency, so must wait for the GPU to complete the drawing.
+    if (m_textureProvider && wd->rhi)
+        finishRhiWorks(wd->rhi);
+
+#ifndef QT_NO_OPENGL
     if (state.flags.testFlag(RedirectOpenGLContextDefaultFrameBufferObject)
         && wd->rhi && wd->rhi->backend() == QRhi::OpenGLES2) {
         auto glContext = QOpenGLContext::currentContext();
@@ -666,6 +701,22 @@ void WBufferRenderer::endRender()
     Q_EMIT afterRendering();
 }
 
+void WBufferRenderer::finishRhiWorks(QRhi *rhi)
+{
+    auto &renderers = rhiPendingRenderers();
+    auto it = renderers.find(rhi);
+    if (it == renderers.end())
+        return;
+
+    renderers.erase(it);
+    rhi->finish();
+}
+
+void WBufferRenderer::resetRhiWorks(QRhi *rhi)
+{
+    rhiPendingRenderers().remove(rhi);
+}
+
 void WBufferRenderer::componentComplete()
 {
     QQuickItem::componentComplete();
@@ -751,6 +802,8 @@ void WBufferRenderer::resetSources()
 void WBufferRenderer::removeSource(int index)
 {
     auto s = m_sourceList.at(index);
+    if (s.damageCollector)
+        delete s.damageCollector;
     if (isRootItem(s.source))
         return;
 
@@ -802,6 +855,112 @@ QSGRenderer *WBufferRenderer::ensureRenderer(int sourceIndex, QSGRenderContext *
     return d.renderer;
 }
 
+QSGRootNode *WBufferRenderer::rootNodeOf(const QQuickItem *source) const
+{
+    return isRootItem(source) ? QQuickWindowPrivate::get(window())->renderer->rootNode()
+                              : WQmlHelper::getRootNode(const_cast<QQuickItem*>(source));
+}
+
+// Returns true if the source may be changed after the last render, it's always
+// true if the changes of the source are not tracked.
+bool WBufferRenderer::sourceIsDirty(int sourceIndex)
+{
+    Data &d = m_sourceList[sourceIndex];
+    if (!d.damageCollector || d.damageCollector->rootNode() != rootNodeOf(d.source))
+        return true;
+
+    return d.damageCollector->hasDamage();
+}
+
+QRect WBufferRenderer::updateDamage(int sourceIndex, const QRectF &sourceRect, const QRect &viewport)
+{
+    Data &d = m_sourceList[sourceIndex];
+
+    auto root = rootNodeOf(d.source);
+    Q_ASSERT(root);
+    // The root node is recreated with the nodes of the source, e.g. after the
+    // scene graph is invalidated, the collector of the old tree is useless.
+    bool rootChanged = false;
+    if (d.damageCollector && d.damageCollector->rootNode() != root) {
+        delete d.damageCollector;
+        d.damageCollector = nullptr;
+        rootChanged = true;
+    }
+
+    if (!d.damageCollector)
+        d.damageCollector = new WSGDamageCollector(root);
+
+    // map from the source to the buffer
+    QTransform transform = state.worldTransform.toTransform();
+    transform *= QTransform::fromTranslate(-sourceRect.x(), -sourceRect.y());
+    transform *= QTransform::fromScale(viewport.width() / sourceRect.width(),
+                                       viewport.height() / sourceRect.height());
+    transform *= QTransform::fromTranslate(viewport.x(), viewport.y());
+
+    QList<QRectF> rects;
+    bool isWhole = !d.damageCollector->takeDamage(&rects) || rootChanged;
+    if (d.damageTransform != transform || d.damageViewport != viewport) {
+        d.damageTransform = transform;
+        d.damageViewport = viewport;
+        isWhole = true;
+    }
+
+    if (isWhole) {
+        m_damageRing.add_whole();
+    } else if (!rects.isEmpty()) {
+        WPixmanRegion damage;
+        for (const QRectF &r : std::as_const(rects)) {
+            // Extend one pixel for the antialiasing and the linear filtering
+            const QRect br = transform.mapRect(r).toAlignedRect().adjusted(-1, -1, 1, 1) & viewport;
+            if (!br.isEmpty())
+                damage.unite(br);
+        }
+
+        if (!damage.isEmpty())
+            m_damageRing.add(damage);
+    }
+
+    if (d.damageCollector->hasUnboundedNode())
+        return viewport;
+
+    WPixmanRegion bufferDamage;
+    m_damageRing.get_buffer_damage(state.bufferAge, bufferDamage);
+    bufferDamage.intersect(viewport);
+    if (bufferDamage.isEmpty())
+        return QRect();
+
+    return bufferDamage.boundingRect();
+}
+
+void WBufferRenderer::clearPaintRect(void *userData)
+{
+#ifndef QT_NO_OPENGL
+    auto self = static_cast<WBufferRenderer*>(userData);
+    Q_ASSERT(self->state.renderer);
+    Q_ASSERT(!self->state.clearRect.isEmpty());
+
+    auto glContext = QOpenGLContext::currentContext();
+    Q_ASSERT(glContext);
+    auto cb = self->state.sgRenderTarget.cb;
+    cb->beginExternal();
+
+    const QRect &r = self->state.clearRect;
+    const QColor color = self->state.renderer->clearColor();
+    const float alpha = color.alphaF();
+    auto f = glContext->functions();
+    f->glEnable(GL_SCISSOR_TEST);
+    f->glScissor(r.x(), r.y(), r.width(), r.height());
+    f->glClearColor(color.redF() * alpha, color.greenF() * alpha, color.blueF() * alpha, alpha);
+    f->glClear(GL_COLOR_BUFFER_BIT);
+    f->glDisable(GL_SCISSOR_TEST);
+
+    cb->endExternal();
+#else
+    Q_UNUSED(userData);
+    Q_UNREACHABLE();
+#endif
+}
+
 WAYLIB_SERVER_END_NAMESPACE
 
 #include "moc_wbufferrenderer_p.cpp"
@@ -19,6 +19,7 @@ Q_MOC_INCLUDE(<private/qsgplaintexture_p.h>)
 QT_BEGIN_NAMESPACE
 class QSGPlainTexture;
 class QSGRenderContext;
+class QRhi;
 namespace QSGBatchRenderer {
 class Renderer;
 }
@@ -35,6 +36,7 @@ WAYLIB_SERVER_BEGIN_NAMESPACE
 
 class WRenderHelper;
 class WSGTextureProvider;
+class WSGDamageCollector;
 class WAYLIB_SERVER_EXPORT WBufferRenderer : public QQuickItem
 {
     friend class WOutputRenderWindow;
@@ -128,6 +130,14 @@ private:
     void removeSource(int index);
     int indexOfSource(QQuickItem *item);
     QSGRenderer *ensureRenderer(int sourceIndex, QSGRenderContext *rc);
+    QSGRootNode *rootNodeOf(const QQuickItem *source) const;
+    bool sourceIsDirty(int sourceIndex);
+    QRect updateDamage(int sourceIndex, const QRectF &sourceRect, const QRect &viewport);
+    static void clearPaintRect(void *userData);
+    // Wait for the GPU to complete the commands recorded by WBufferRenderer
+    static void finishRhiWorks(QRhi *rhi);
+    // Call after QRhi::endOffscreenFrame, it has waited for the commands
+    static void resetRhiWorks(QRhi *rhi);
 
     QW_NAMESPACE::qw_swapchain *m_swapchain = nullptr;
     WRenderHelper *m_renderHelper = nullptr;
@@ -146,6 +156,8 @@ private:
         QQuickRenderTarget renderTarget;
         QSGRenderTarget sgRenderTarget;
         QRegion dirty;
+        // for clearPaintRect, it's in the render target's coordinate system
+        QRect clearRect;
     } state;
 
     QPointer<WOutput> m_output;
@@ -153,6 +165,11 @@ private:
     struct Data {
         QQuickItem *source = nullptr; // Don't using QPointer, See isRootItem
         QSGRenderer *renderer = nullptr;
+        // Only for the RHI renderer, the software renderer has itself dirty region
+        WSGDamageCollector *damageCollector = nullptr;
+        // Map the source to the buffer in the last render
+        QTransform damageTransform;
+        QRect damageViewport;
     };
 
     QList<Data> m_sourceList;
@@ -0,0 +1,62 @@
+// Copyright (C) 2024 JiDe Zhang <zhangjide@deepin.org>.
+// SPDX-License-Identifier: Apache-2.0 OR LGPL-3.0-only OR GPL-2.0-only OR GPL-3.0-only
+
+#pragma once
+
+#include "wframecapturer.h"
+#include "wpixmanregion_p.h"
+
+#include <QPointer>
+#include <QElapsedTimer>
+
+QT_BEGIN_NAMESPACE
+class QTimer;
+QT_END_NAMESPACE
+
+WAYLIB_SERVER_BEGIN_NAMESPACE
+
+class Q_DECL_HIDDEN WFrameCapturerPrivate : public WObjectPrivate
+{
+public:
+    WFrameCapturerPrivate(WFrameCapturer *qq)
+        : WObjectPrivate(qq) {}
+    ~WFrameCapturerPrivate();
+
+    inline static WFrameCapturerPrivate *get(WFrameCapturer *capturer) {
+        return capturer->d_func();
+    }
+
+    // Called by WOutputRenderWindow when a frame of the viewport is committed,
+    // the damage is relative to the frame of the last call, nullptr if the
+    // whole buffer is damaged.
+    void onFrame(QW_NAMESPACE::qw_buffer *buffer, const pixman_region32_t *damage);
+
+    void attach();
+    void detach();
+    void scheduleSend();
+    void sendFrame();
+    void dropPendingFrame();
+
+    W_DECLARE_PUBLIC(WFrameCapturer)
+
+    QPointer<WOutputViewport> viewport;
+    bool active = false;
+    bool withCursor = false;
+    bool attached = false;
+    int maxFrameRate = 0;
+
+    // The latest frame waiting to send, its damage is accumulated since
+    // the last sent frame
+    QW_NAMESPACE::qw_buffer *pendingBuffer = nullptr;
+    WPixmanRegion pendingDamage;
+    bool needsWholeFrame = true;
+    bool sendIsQueued = false;
+
+    // Locked until WFrameCapturer::releaseFrame
+    QW_NAMESPACE::qw_buffer *sentBuffer = nullptr;
+    QSize lastSentSize;
+    QElapsedTimer lastSentTime;
+    QTimer *pacingTimer = nullptr;
+};
+
+WAYLIB_SERVER_END_NAMESPACE
@@ -17,6 +17,7 @@ QW_USE_NAMESPACE
 WAYLIB_SERVER_BEGIN_NAMESPACE
 
 class OutputTextureProvider;
+class WFrameCapturer;
 class Q_DECL_HIDDEN WOutputViewportPrivate : public QQuickItemPrivate
 {
 public:
@@ -81,6 +82,9 @@ public:
     QPointer<QQuickItem> extraRenderSource;
     QRectF sourceRect;
     QRectF targetRect;
+    // for WFrameCapturer
+    QList<WFrameCapturer*> frameCapturers;
+    int cursorCaptureCount = 0;
 
     uint attached:1;
     uint offscreen:1;
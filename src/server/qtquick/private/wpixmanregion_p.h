@@ -0,0 +1,147 @@
+// Copyright (C) 2024 JiDe Zhang <zhangjide@deepin.org>.
+// SPDX-License-Identifier: Apache-2.0 OR LGPL-3.0-only OR GPL-2.0-only OR GPL-3.0-only
+
+#pragma once
+
+#include <wglobal.h>
+#include <wtools.h>
+
+#include <QRect>
+#include <QRegion>
+
+#include <pixman.h>
+extern "C" {
+#include <wlr/util/region.h>
+}
+
+WAYLIB_SERVER_BEGIN_NAMESPACE
+
+// A pixman_region32_t owned by the stack, all operations are done by pixman
+// in place, only convert to QRegion when a Qt API requires it. The damage of
+// wlroots is a pixman region, keep it as a pixman region as long as possible
+// to avoid the QRegion round-trips.
+class Q_DECL_HIDDEN WPixmanRegion
+{
+public:
+    // Iterate the rectangles of the region as QRect without copy
+    class const_iterator
+    {
+    public:
+        inline explicit const_iterator(const pixman_box32_t *box)
+            : m_box(box) {}
+
+        inline QRect operator*() const {
+            return QRect(QPoint(m_box->x1, m_box->y1), QPoint(m_box->x2 - 1, m_box->y2 - 1));
+        }
+        inline const_iterator &operator++() {
+            ++m_box;
+            return *this;
+        }
+        inline bool operator==(const const_iterator &other) const {
+            return m_box == other.m_box;
+        }
+        inline bool operator!=(const const_iterator &other) const {
+            return m_box != other.m_box;
+        }
+
+    private:
+        const pixman_box32_t *m_box;
+    };
+
+    WPixmanRegion() {
+        pixman_region32_init(&data);
+    }
+    explicit WPixmanRegion(const QRect &rect) {
+        pixman_region32_init_rect(&data, rect.x(), rect.y(), rect.width(), rect.height());
+    }
+    explicit WPixmanRegion(const QRegion &region) {
+        pixman_region32_init(&data);
+        setRegion(region);
+    }
+    WPixmanRegion(const WPixmanRegion &other) {
+        pixman_region32_init(&data);
+        pixman_region32_copy(&data, &other.data);
+    }
+    WPixmanRegion &operator=(const WPixmanRegion &other) {
+        pixman_region32_copy(&data, &other.data);
+        return *this;
+    }
+    ~WPixmanRegion() {
+        pixman_region32_fini(&data);
+    }
+
+    inline operator pixman_region32_t*() {
+        return &data;
+    }
+    inline operator const pixman_region32_t*() const {
+        return &data;
+    }
+
+    inline bool isEmpty() const {
+        return !pixman_region32_not_empty(&data);
+    }
+    inline int rectCount() const {
+        return pixman_region32_n_rects(&data);
+    }
+    inline QRect boundingRect() const {
+        const auto e = pixman_region32_extents(&data);
+        return QRect(QPoint(e->x1, e->y1), QPoint(e->x2 - 1, e->y2 - 1));
+    }
+
+    inline const_iterator begin() const {
+        int count = 0;
+        return const_iterator(pixman_region32_rectangles(&data, &count));
+    }
+    inline const_iterator end() const {
+        int count = 0;
+        const auto rects = pixman_region32_rectangles(&data, &count);
+        return const_iterator(rects + count);
+    }
+
+    inline void clear() {
+        pixman_region32_clear(&data);
+    }
+    inline void unite(const QRect &rect) {
+        pixman_region32_union_rect(&data, &data, rect.x(), rect.y(), rect.width(), rect.height());
+    }
+    inline void unite(const WPixmanRegion &region) {
+        pixman_region32_union(&data, &data, &region.data);
+    }
+    inline void intersect(const QRect &rect) {
+        pixman_region32_intersect_rect(&data, &data, rect.x(), rect.y(), rect.width(), rect.height());
+    }
+    inline void intersect(const WPixmanRegion &region) {
+        pixman_region32_intersect(&data, &data, &region.data);
+    }
+    inline void subtract(const QRect &rect) {
+        const WPixmanRegion r(rect);
+        pixman_region32_subtract(&data, &data, &r.data);
+    }
+    inline void subtract(const WPixmanRegion &region) {
+        pixman_region32_subtract(&data, &data, &region.data);
+    }
+    inline void translate(const QPoint &offset) {
+        pixman_region32_translate(&data, offset.x(), offset.y());
+    }
+    // The new rectangles are extended to the integer bounds outside the
+    // scaled rectangles, so the scaled region always covers the source area.
+    inline void scale(qreal scale) {
+        if (scale != 1.0)
+            wlr_region_scale(&data, &data, scale);
+    }
+
+    // Returns false if failed to allocate the memory, the region is empty in
+    // this case, see WTools::toPixmanRegion.
+    bool setRegion(const QRegion &region) {
+        pixman_region32_fini(&data);
+        return WTools::toPixmanRegion(region, &data);
+    }
+
+    QRegion toRegion() const {
+        return WTools::fromPixmanRegion(const_cast<pixman_region32_t*>(&data));
+    }
+
+    pixman_region32_t data;
+};
+
+WAYLIB_SERVER_END_NAMESPACE
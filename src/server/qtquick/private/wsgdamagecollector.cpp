@@ -0,0 +1,256 @@
+// Copyright (C) 2024 JiDe Zhang <zhangjide@deepin.org>.
+// SPDX-License-Identifier: Apache-2.0 OR LGPL-3.0-only OR GPL-2.0-only OR GPL-3.0-only
+
+#include "wsgdamagecollector_p.h"
+
+#include <QSGNode>
+#include <QSGRenderNode>
+#include <QMatrix4x4>
+#include <QStack>
+
+#include <limits>
+
+WAYLIB_SERVER_BEGIN_NAMESPACE
+
+static int sizeOfType(int type)
+{
+    switch (type) {
+    case QSGGeometry::ByteType:
+    case QSGGeometry::UnsignedByteType:
+        return 1;
+    case QSGGeometry::ShortType:
+    case QSGGeometry::UnsignedShortType:
+        return 2;
+    case QSGGeometry::DoubleType:
+        return 8;
+    default:
+        break;
+    }
+
+    return 4;
+}
+
+// Returns false if can't get the vertex coordinate from the geometry
+static bool geometryBounds(const QSGGeometry *g, QRectF *bounds)
+{
+    *bounds = QRectF();
+    if (!g || g->vertexCount() <= 0)
+        return true;
+
+    const QSGGeometry::Attribute *attributes = g->attributes();
+    const QSGGeometry::Attribute *position = nullptr;
+    int offset = 0;
+
+    for (int i = 0; i < g->attributeCount(); ++i) {
+        if (attributes[i].isVertexCoordinate) {
+            position = &attributes[i];
+            break;
+        }
+        offset += attributes[i].tupleSize * sizeOfType(attributes[i].type);
+    }
+
+    // Follow Qt, the first attribute is position if not specify
+    if (!position) {
+        position = &attributes[0];
+        offset = 0;
+    }
+
+    if (position->type != QSGGeometry::FloatType || position->tupleSize < 2)
+        return false;
+
+    float x1 = std::numeric_limits<float>::max();
+    float y1 = x1;
+    float x2 = std::numeric_limits<float>::lowest();
+    float y2 = x2;
+
+    const auto data = static_cast<const char*>(g->vertexData()) + offset;
+    const int stride = g->sizeOfVertex();
+    for (int i = 0; i < g->vertexCount(); ++i) {
+        const float *p = reinterpret_cast<const float*>(data + i * stride);
+        x1 = std::min(x1, p[0]);
+        x2 = std::max(x2, p[0]);
+        y1 = std::min(y1, p[1]);
+        y2 = std::max(y2, p[1]);
+    }
+
+    *bounds = QRectF(QPointF(x1, y1), QPointF(x2, y2));
+    return true;
+}
+
+WSGDamageCollector::WSGDamageCollector(QSGRootNode *root, QObject *parent)
+    : QSGAbstractRenderer(parent)
+{
+    // Will receive QSGNode::DirtyNodeAdded for the root node, so the first
+    // takeDamage will walk the whole tree.
+    setRootNode(root);
+}
+
+WSGDamageCollector::~WSGDamageCollector()
+{
+    m_detaching = true;
+    setRootNode(nullptr);
+}
+
+void WSGDamageCollector::collectDamage()
+{
+    m_damage.append(m_removedBounds);
+    m_removedBounds.clear();
+
+    const auto dirtyNodes = std::exchange(m_dirtyNodes, {});
+    for (QSGNode *node : dirtyNodes)
+        updateSubtree(node, &m_damage);
+}
+
+bool WSGDamageCollector::hasDamage()
+{
+    collectDamage();
+    return m_wholeDamaged || !m_damage.isEmpty();
+}
+
+bool WSGDamageCollector::takeDamage(QList<QRectF> *rects)
+{
+    collectDamage();
+    rects->append(std::exchange(m_damage, {}));
+
+    if (std::exchange(m_wholeDamaged, false))
+        return false;
+
+    if (rects->isEmpty())
+        return true;
+
+    if (hasUnboundedNode())
+        return false;
+
+    // Some render nodes will read the contents behind it (e.g. blur), should
+    // repaint them if the contents is changed.
+    const auto count = rects->size();
+    for (const QSGNode *node : std::as_const(m_renderNodes)) {
+        const QRectF bounds = m_bounds.value(node);
+        if (bounds.isEmpty())
+            continue;
+
+        for (int i = 0; i < count; ++i) {
+            if (rects->at(i).intersects(bounds)) {
+                rects->append(bounds);
+                break;
+            }
+        }
+    }
+
+    return true;
+}
+
+void WSGDamageCollector::nodeChanged(QSGNode *node, QSGNode::DirtyState state)
+{
+    if (m_detaching)
+        return;
+
+    // The node will be destroyed soon, must take its bounds now
+    if (state & QSGNode::DirtyNodeRemoved) {
+        removeSubtree(node);
+        return;
+    }
+
+    m_dirtyNodes.insert(node);
+}
+
+void WSGDamageCollector::removeSubtree(QSGNode *node)
+{
+    QStack<QSGNode*> nodes;
+    nodes.push(node);
+
+    while (!nodes.isEmpty()) {
+        auto n = nodes.pop();
+
+        m_dirtyNodes.remove(n);
+        m_renderNodes.remove(n);
+        m_unboundedNodes.remove(n);
+
+        auto it = m_bounds.constFind(n);
+        if (it != m_bounds.constEnd()) {
+            m_removedBounds.append(it.value());
+            m_bounds.erase(it);
+        }
+
+        for (auto child = n->firstChild(); child; child = child->nextSibling())
+            nodes.push(child);
+    }
+}
+
+void WSGDamageCollector::updateSubtree(QSGNode *node, QList<QRectF> *rects)
+{
+    struct Item {
+        QSGNode *node;
+        QMatrix4x4 matrix;
+        bool visible;
+    };
+
+    Item top { node, {}, true };
+    if (node != rootNode()) {
+        for (auto p = node->parent(); p && p != rootNode(); p = p->parent()) {
+            if (p->type() == QSGNode::TransformNodeType)
+                top.matrix = static_cast<QSGTransformNode*>(p)->matrix() * top.matrix;
+            if (p->isSubtreeBlocked())
+                top.visible = false;
+        }
+    }
+
+    QStack<Item> nodes;
+    nodes.push(top);
+
+    while (!nodes.isEmpty()) {
+        const auto i = nodes.pop();
+        QRectF bounds;
+
+        if (i.node->type() == QSGNode::GeometryNodeType) {
+            auto gn = static_cast<QSGGeometryNode*>(i.node);
+            if (geometryBounds(gn->geometry(), &bounds)) {
+                m_unboundedNodes.remove(gn);
+            } else {
+                m_unboundedNodes.insert(gn);
+                bounds = QRectF();
+            }
+        } else if (i.node->type() == QSGNode::RenderNodeType) {
+            auto rn = static_cast<QSGRenderNode*>(i.node);
+            if (rn->flags().testFlag(QSGRenderNode::BoundedRectRendering)) {
+                bounds = rn->rect();
+                m_unboundedNodes.remove(rn);
+                m_renderNodes.insert(rn);
+            } else {
+                m_unboundedNodes.insert(rn);
+                m_renderNodes.remove(rn);
+            }
+        }
+
+        if (!i.visible)
+            bounds = QRectF();
+        else if (m_unboundedNodes.contains(i.node))
+            m_wholeDamaged = true;
+        else if (!bounds.isEmpty())
+            bounds = i.matrix.mapRect(bounds);
+
+        auto it = m_bounds.find(i.node);
+        if (it != m_bounds.end()) {
+            rects->append(it.value());
+            if (bounds.isEmpty())
+                m_bounds.erase(it);
+            else
+                it.value() = bounds;
+        } else if (!bounds.isEmpty()) {
+            m_bounds.insert(i.node, bounds);
+        }
+
+        if (!bounds.isEmpty())
+            rects->append(bounds);
+
+        QMatrix4x4 childMatrix = i.matrix;
+        if (i.node->type() == QSGNode::TransformNodeType)
+            childMatrix = childMatrix * static_cast<QSGTransformNode*>(i.node)->matrix();
+        const bool childVisible = i.visible && !i.node->isSubtreeBlocked();
+
+        for (auto child = i.node->firstChild(); child; child = child->nextSibling())
+            nodes.push({child, childMatrix, childVisible});
+    }
+}
+
+WAYLIB_SERVER_END_NAMESPACE
@@ -0,0 +1,61 @@
+// Copyright (C) 2024 JiDe Zhang <zhangjide@deepin.org>.
+// SPDX-License-Identifier: Apache-2.0 OR LGPL-3.0-only OR GPL-2.0-only OR GPL-3.0-only
+
+#pragma once
+
+#include <wglobal.h>
+
+#include <QHash>
+#include <QSet>
+#include <QRectF>
+#include <private/qsgabstractrenderer_p.h>
+
+QT_BEGIN_NAMESPACE
+class QSGRootNode;
+class QSGNode;
+QT_END_NAMESPACE
+
+WAYLIB_SERVER_BEGIN_NAMESPACE
+
+// Listen the node changes of a QSGRootNode like a QSGRenderer, but don't render
+// anything, only collect the area of the changed nodes. The area is relative
+// the root node, needs map it to the render target by the render matrix.
+class Q_DECL_HIDDEN WSGDamageCollector : public QSGAbstractRenderer
+{
+public:
+    explicit WSGDamageCollector(QSGRootNode *root, QObject *parent = nullptr);
+    ~WSGDamageCollector();
+
+    // Returns false if the whole area of the root node is damaged, in this
+    // case the "rects" is undefined.
+    bool takeDamage(QList<QRectF> *rects);
+    // Returns true if the nodes are changed after the last takeDamage, the
+    // damage is kept for the next takeDamage.
+    bool hasDamage();
+    // The render node without QSGRenderNode::BoundedRectRendering maybe paint
+    // to anywhere, so the partial update is unsafe if the scene contains it.
+    inline bool hasUnboundedNode() const {
+        return !m_unboundedNodes.isEmpty();
+    }
+
+    void renderScene() override {}
+
+private:
+    void nodeChanged(QSGNode *node, QSGNode::DirtyState state) override;
+    void removeSubtree(QSGNode *node);
+    void updateSubtree(QSGNode *node, QList<QRectF> *rects);
+    void collectDamage();
+
+    QSet<QSGNode*> m_dirtyNodes;
+    // The last bounds of the geometry nodes and render nodes
+    QHash<const QSGNode*, QRectF> m_bounds;
+    QSet<const QSGNode*> m_renderNodes;
+    QSet<const QSGNode*> m_unboundedNodes;
+    QList<QRectF> m_removedBounds;
+    QList<QRectF> m_damage;
+    // A visible node without the bounds is changed
+    bool m_wholeDamaged = false;
+    bool m_detaching = false;
+};
+
+WAYLIB_SERVER_END_NAMESPACE
@@ -0,0 +1,91 @@
+// Copyright (C) 2024 JiDe Zhang <zhangjide@deepin.org>.
+// SPDX-License-Identifier: Apache-2.0 OR LGPL-3.0-only OR GPL-2.0-only OR GPL-3.0-only
+
+#include "wsgtexturecache_p.h"
+#include "wrenderhelper.h"
+
+#include <qwbuffer.h>
+#include <qwtexture.h>
+
+#include <rhi/qrhi.h>
+#include <private/qsgplaintexture_p.h>
+
+QW_USE_NAMESPACE
+WAYLIB_SERVER_BEGIN_NAMESPACE
+
+WSGTextureCache::WSGTextureCache(QObject *parent)
+    : QObject(parent)
+{
+
+}
+
+WSGTextureCache::~WSGTextureCache()
+{
+    clear();
+}
+
+bool WSGTextureCache::makeTexture(QRhi *rhi, qw_texture *texture, qw_buffer *buffer,
+                                  QSGPlainTexture *qtTexture, bool *isCached)
+{
+    *isCached = false;
+
+    // The texture of a dmabuf is kept by wlroots until the dmabuf is destroyed,
+    // the texture of the other buffers maybe destroyed with the client buffer.
+    auto clientBuffer = buffer ? qw_client_buffer::get(*buffer) : nullptr;
+    wlr_buffer *source = clientBuffer ? clientBuffer->handle()->source : nullptr;
+    wlr_dmabuf_attributes attribs;
+    if (!rhi || !source || !wlr_buffer_get_dmabuf(source, &attribs))
+        return WRenderHelper::makeTexture(rhi, texture, qtTexture);
+
+    auto it = m_entries.find(source);
+    if (it != m_entries.end() && it->texture == texture->handle()) {
+        ++m_hits;
+        qtTexture->setTexture(it->rhiTexture);
+        qtTexture->setHasAlphaChannel(it->hasAlphaChannel);
+        *isCached = true;
+        return true;
+    }
+
+    ++m_misses;
+    if (!WRenderHelper::makeTexture(rhi, texture, qtTexture))
+        return false;
+
+    if (it == m_entries.end()) {
+        it = m_entries.insert(source, {});
+        auto qwSource = qw_buffer::from(source);
+        it->destroyConnection = connect(qwSource, &qw_buffer::before_destroy, this, [this, source] {
+            remove(source);
+        });
+    } else if (it->rhiTexture) {
+        // The native texture is changed
+        it->rhiTexture->deleteLater();
+    }
+
+    it->texture = texture->handle();
+    it->rhiTexture = qtTexture->rhiTexture();
+    it->hasAlphaChannel = qtTexture->hasAlphaChannel();
+    *isCached = true;
+
+    return true;
+}
+
+void WSGTextureCache::clear()
+{
+    for (const auto &entry : std::as_const(m_entries)) {
+        disconnect(entry.destroyConnection);
+        delete entry.rhiTexture;
+    }
+
+    m_entries.clear();
+}
+
+void WSGTextureCache::remove(wlr_buffer *buffer)
+{
+    auto entry = m_entries.take(buffer);
+    disconnect(entry.destroyConnection);
+    // Release at the end of the current frame, the texture maybe in using
+    if (entry.rhiTexture)
+        entry.rhiTexture->deleteLater();
+}
+
+WAYLIB_SERVER_END_NAMESPACE
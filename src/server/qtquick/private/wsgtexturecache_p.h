@@ -0,0 +1,70 @@
+// Copyright (C) 2024 JiDe Zhang <zhangjide@deepin.org>.
+// SPDX-License-Identifier: Apache-2.0 OR LGPL-3.0-only OR GPL-2.0-only OR GPL-3.0-only
+
+#pragma once
+
+#include <wglobal.h>
+#include <qwglobal.h>
+
+#include <QObject>
+#include <QHash>
+#include <QSize>
+
+QT_BEGIN_NAMESPACE
+class QRhi;
+class QRhiTexture;
+class QSGPlainTexture;
+QT_END_NAMESPACE
+
+QW_BEGIN_NAMESPACE
+class qw_texture;
+class qw_buffer;
+QW_END_NAMESPACE
+
+struct wlr_buffer;
+struct wlr_texture;
+WAYLIB_SERVER_BEGIN_NAMESPACE
+
+// Keep the QRhiTexture that wraps the native texture of a client's dmabuf
+// alive until the dmabuf is destroyed. The clients usually cycle two or three
+// buffers, wlroots reuses the native texture for the same dmabuf, so the
+// QRhiTexture can be reused too. Only for the RHI renderer.
+class Q_DECL_HIDDEN WSGTextureCache : public QObject
+{
+public:
+    struct Statistics {
+        quint64 hits = 0;
+        quint64 misses = 0;
+        int size = 0;
+    };
+
+    explicit WSGTextureCache(QObject *parent = nullptr);
+    ~WSGTextureCache();
+
+    // Like WRenderHelper::makeTexture, the "isCached" will be true if the
+    // QRhiTexture of the "qtTexture" is owned by the cache, don't delete it.
+    bool makeTexture(QRhi *rhi, QW_NAMESPACE::qw_texture *texture,
+                     QW_NAMESPACE::qw_buffer *buffer, QSGPlainTexture *qtTexture,
+                     bool *isCached);
+    void clear();
+
+    inline Statistics statistics() const {
+        return {m_hits, m_misses, int(m_entries.size())};
+    }
+
+private:
+    void remove(wlr_buffer *buffer);
+
+    struct Entry {
+        wlr_texture *texture = nullptr;
+        QRhiTexture *rhiTexture = nullptr;
+        bool hasAlphaChannel = false;
+        QMetaObject::Connection destroyConnection;
+    };
+
+    QHash<wlr_buffer*, Entry> m_entries;
+    quint64 m_hits = 0;
+    quint64 m_misses = 0;
+};
+
+WAYLIB_SERVER_END_NAMESPACE
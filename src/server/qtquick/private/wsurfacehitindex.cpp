@@ -0,0 +1,277 @@
+// Copyright (C) 2024 JiDe Zhang <zhangjide@deepin.org>.
+// SPDX-License-Identifier: Apache-2.0 OR LGPL-3.0-only OR GPL-2.0-only OR GPL-3.0-only
+
+#include "wsurfacehitindex_p.h"
+
+#include <QQuickItem>
+#include <QQuickWindow>
+#include <QSet>
+#include <QtMath>
+
+#include <private/qquickitem_p.h>
+#include <private/qquickwindow_p.h>
+
+WAYLIB_SERVER_BEGIN_NAMESPACE
+
+// Compare the paint order of the children of the nearest common ancestor
+static bool isStackedAbove(QQuickItem *item, QQuickItem *other)
+{
+    QVarLengthArray<QQuickItem*, 32> itemPath;
+    QVarLengthArray<QQuickItem*, 32> otherPath;
+    for (QQuickItem *i = item; i; i = i->parentItem())
+        itemPath.append(i);
+    for (QQuickItem *i = other; i; i = i->parentItem())
+        otherPath.append(i);
+
+    qsizetype i = itemPath.size() - 1;
+    qsizetype j = otherPath.size() - 1;
+    if (itemPath.at(i) != otherPath.at(j))
+        return false;
+    while (i >= 0 && j >= 0 && itemPath.at(i) == otherPath.at(j)) {
+        --i;
+        --j;
+    }
+
+    // The children are painted over their parent
+    if (i < 0)
+        return false;
+    if (j < 0)
+        return true;
+
+    const auto children = QQuickItemPrivate::get(itemPath.at(i)->parentItem())->paintOrderChildItems();
+    return children.indexOf(itemPath.at(i)) > children.indexOf(otherPath.at(j));
+}
+
+// The items may take the pointer events from the surfaces below them. It's
+// checked in every query, the items may accept the pointer events later without
+// any change of geometry (e.g. MouseArea.hoverEnabled is changed by a binding).
+// The items having pointer handlers are taken as accepting even if the handlers
+// are disabled, the pointer events go through Qt Quick for them.
+static bool acceptsPointerEvents(QQuickItem *item)
+{
+    return item->acceptHoverEvents()
+        || item->acceptedMouseButtons() != Qt::NoButton
+        || QQuickItemPrivate::get(item)->hasPointerHandlers();
+}
+
+// Qt Quick doesn't deliver the pointer events to the children out of the shape
+// of an ancestor clipping its children
+static bool isClippedOut(QQuickItem *item, const QPointF &scenePos)
+{
+    for (QQuickItem *p = item->parentItem(); p; p = p->parentItem()) {
+        if (p->clip() && !p->contains(p->mapFromScene(scenePos)))
+            return true;
+    }
+
+    return false;
+}
+
+static void collectItems(QQuickItem *item, QList<QQuickItem*> *items)
+{
+    items->append(item);
+    const auto children = item->childItems();
+    for (QQuickItem *child : children)
+        collectItems(child, items);
+}
+
+// The index of the windows, the index is destroyed with its window
+static QHash<QQuickWindow*, WSurfaceHitIndex*> hitIndexes;
+
+WSurfaceHitIndex::WSurfaceHitIndex(QQuickWindow *window)
+    : QObject(window)
+    , m_window(window)
+{
+    connect(window, &QQuickWindow::beforeSynchronizing,
+            this, &WSurfaceHitIndex::markDirtyItems, Qt::DirectConnection);
+
+    // The later items are found by markDirtyItems, Qt Quick marks the items
+    // dirty when they are added to the window.
+    QList<QQuickItem*> items;
+    collectItems(window->contentItem(), &items);
+    for (QQuickItem *item : std::as_const(items))
+        insert(item);
+}
+
+WSurfaceHitIndex::~WSurfaceHitIndex()
+{
+    hitIndexes.remove(m_window);
+}
+
+WSurfaceHitIndex *WSurfaceHitIndex::get(QQuickWindow *window)
+{
+    auto &index = hitIndexes[window];
+    if (!index)
+        index = new WSurfaceHitIndex(window);
+    return index;
+}
+
+void WSurfaceHitIndex::insert(QQuickItem *item)
+{
+    Q_ASSERT(item->window() == m_window);
+    auto &entry = m_entries[item];
+    entry.dirty = true;
+    m_hasDirty = true;
+
+    if (!entry.destroyConnection) {
+        entry.destroyConnection = connect(item, &QObject::destroyed, this, [this, item] {
+            remove(item);
+        });
+    }
+}
+
+void WSurfaceHitIndex::remove(QQuickItem *item)
+{
+    auto it = m_entries.find(item);
+    if (it == m_entries.end())
+        return;
+
+    disconnect(it->destroyConnection);
+    removeFromCells(item, *it);
+    m_entries.erase(it);
+}
+
+QQuickItem *WSurfaceHitIndex::itemAt(const QPointF &scenePos, QPointF *localPos)
+{
+    // Take the changes not synchronized to the scene graph yet, so the result
+    // is the same as the Qt Quick delivery of this moment
+    markDirtyItems();
+    if (m_hasDirty) {
+        for (auto it = m_entries.begin(); it != m_entries.end(); ++it) {
+            if (it->dirty)
+                updateEntry(it.key(), *it);
+        }
+        m_hasDirty = false;
+    }
+
+    QQuickItem *target = nullptr;
+    QPointF targetPos;
+    auto testItem = [&] (QQuickItem *item) {
+        const auto entry = m_entries.constFind(item);
+        if (entry == m_entries.constEnd() || !entry->sceneRect.contains(scenePos))
+            return;
+        if (!item->isVisible() || !item->isEnabled() || item->window() != m_window)
+            return;
+        if (!acceptsPointerEvents(item))
+            return;
+
+        const QPointF pos = item->mapFromScene(scenePos);
+        if (!item->contains(pos) || isClippedOut(item, scenePos))
+            return;
+        if (target && !isStackedAbove(item, target))
+            return;
+
+        target = item;
+        targetPos = pos;
+    };
+
+    const auto cell = m_cells.constFind(cellKey(qFloor(scenePos.x() / cellSize),
+                                                qFloor(scenePos.y() / cellSize)));
+    if (cell != m_cells.constEnd()) {
+        for (QQuickItem *item : std::as_const(*cell))
+            testItem(item);
+    }
+    for (QQuickItem *item : std::as_const(m_largeItems))
+        testItem(item);
+
+    if (target && localPos)
+        *localPos = targetPos;
+
+    return target;
+}
+
+// Called before the dirty items are synchronized to the scene graph and in the
+// queries, the moving of an ancestor changes the scene rectangles of all the
+// items in its subtree.
+void WSurfaceHitIndex::markDirtyItems()
+{
+    constexpr quint32 geometryMask = QQuickItemPrivate::TransformUpdateMask
+                                     | QQuickItemPrivate::Size
+                                     | QQuickItemPrivate::ParentChanged
+                                     | QQuickItemPrivate::Window;
+    QSet<QQuickItem*> dirtyItems;
+    auto wd = QQuickWindowPrivate::get(m_window);
+    for (QQuickItem *item = wd->dirtyItemList; item; item = QQuickItemPrivate::get(item)->nextDirtyItem) {
+        if (!(QQuickItemPrivate::get(item)->dirtyAttributes & geometryMask))
+            continue;
+        dirtyItems.insert(item);
+        // A new item in the window, or an item moved from another window
+        if (!m_entries.contains(item) && item->window() == m_window)
+            insert(item);
+    }
+
+    for (QQuickItem *item : std::as_const(dirtyItems)) {
+        // The subtree is marked with the dirty ancestor
+        bool hasDirtyAncestor = false;
+        for (QQuickItem *p = item->parentItem(); p; p = p->parentItem()) {
+            if (dirtyItems.contains(p)) {
+                hasDirtyAncestor = true;
+                break;
+            }
+        }
+
+        if (!hasDirtyAncestor)
+            markSubtreeDirty(item);
+    }
+}
+
+void WSurfaceHitIndex::markSubtreeDirty(QQuickItem *item)
+{
+    auto it = m_entries.find(item);
+    if (it != m_entries.end()) {
+        it->dirty = true;
+        m_hasDirty = true;
+    }
+
+    const auto children = item->childItems();
+    for (QQuickItem *child : children)
+        markSubtreeDirty(child);
+}
+
+void WSurfaceHitIndex::updateEntry(QQuickItem *item, Entry &entry)
+{
+    removeFromCells(item, entry);
+    entry.cells.clear();
+    entry.large = false;
+    entry.dirty = false;
+    entry.sceneRect = item->mapRectToScene(item->boundingRect());
+    if (entry.sceneRect.isEmpty())
+        return;
+
+    // The huge items (e.g. the content of a Flickable) are tested in every query
+    if ((entry.sceneRect.width() / cellSize + 2) * (entry.sceneRect.height() / cellSize + 2) > maxCellsPerItem) {
+        entry.large = true;
+        m_largeItems.append(item);
+        return;
+    }
+
+    const int left = qFloor(entry.sceneRect.left() / cellSize);
+    const int top = qFloor(entry.sceneRect.top() / cellSize);
+    const int right = qFloor(entry.sceneRect.right() / cellSize);
+    const int bottom = qFloor(entry.sceneRect.bottom() / cellSize);
+
+    for (int y = top; y <= bottom; ++y) {
+        for (int x = left; x <= right; ++x) {
+            const CellKey key = cellKey(x, y);
+            entry.cells.append(key);
+            m_cells[key].append(item);
+        }
+    }
+}
+
+void WSurfaceHitIndex::removeFromCells(QQuickItem *item, const Entry &entry)
+{
+    if (entry.large)
+        m_largeItems.removeOne(item);
+
+    for (CellKey key : std::as_const(entry.cells)) {
+        auto cell = m_cells.find(key);
+        if (cell == m_cells.end())
+            continue;
+
+        cell->removeOne(item);
+        if (cell->isEmpty())
+            m_cells.erase(cell);
+    }
+}
+
+WAYLIB_SERVER_END_NAMESPACE
@@ -0,0 +1,71 @@
+// Copyright (C) 2024 JiDe Zhang <zhangjide@deepin.org>.
+// SPDX-License-Identifier: Apache-2.0 OR LGPL-3.0-only OR GPL-2.0-only OR GPL-3.0-only
+
+#pragma once
+
+#include <wglobal.h>
+
+#include <QObject>
+#include <QHash>
+#include <QRectF>
+#include <QVarLengthArray>
+
+QT_BEGIN_NAMESPACE
+class QQuickItem;
+class QQuickWindow;
+QT_END_NAMESPACE
+
+WAYLIB_SERVER_BEGIN_NAMESPACE
+
+// A uniform grid over the scene rectangles of the items in a QQuickWindow, to
+// find the input item of WSurfaceItem or the other item accepting the pointer
+// events (e.g. panels, decorations, menus) under the pointer without walking
+// the whole item tree. The rectangles are remapped only for the items whose
+// geometry or whose ancestors' geometry has changed, the visibility and the
+// acceptance of the pointer events are checked in the query.
+class Q_DECL_HIDDEN WSurfaceHitIndex : public QObject
+{
+public:
+    // The index is owned by the window, create it if not exists
+    static WSurfaceHitIndex *get(QQuickWindow *window);
+
+    void insert(QQuickItem *item);
+    void remove(QQuickItem *item);
+
+    // Returns the topmost visible item that contains the position in its
+    // input region, the "localPos" is in the coordinate system of the item.
+    QQuickItem *itemAt(const QPointF &scenePos, QPointF *localPos = nullptr);
+
+private:
+    explicit WSurfaceHitIndex(QQuickWindow *window);
+    ~WSurfaceHitIndex() override;
+
+    using CellKey = quint64;
+    static constexpr int cellSize = 512;
+    static inline CellKey cellKey(int x, int y) {
+        return (quint64(quint32(x)) << 32) | quint32(y);
+    }
+
+    struct Entry {
+        QRectF sceneRect;
+        QVarLengthArray<CellKey, 8> cells;
+        QMetaObject::Connection destroyConnection;
+        bool dirty = true;
+        // In m_largeItems instead of the cells
+        bool large = false;
+    };
+    static constexpr int maxCellsPerItem = 64;
+
+    void markDirtyItems();
+    void markSubtreeDirty(QQuickItem *item);
+    void updateEntry(QQuickItem *item, Entry &entry);
+    void removeFromCells(QQuickItem *item, const Entry &entry);
+
+    QQuickWindow *m_window;
+    QHash<QQuickItem*, Entry> m_entries;
+    QHash<CellKey, QList<QQuickItem*>> m_cells;
+    QList<QQuickItem*> m_largeItems;
+    bool m_hasDirty = false;
+};
+
+WAYLIB_SERVER_END_NAMESPACE
@@ -0,0 +1,242 @@
+// Copyright (C) 2024 JiDe Zhang <zhangjide@deepin.org>.
+// SPDX-License-Identifier: Apache-2.0 OR LGPL-3.0-only OR GPL-2.0-only OR GPL-3.0-only
+
+#include "wframecapturer.h"
+#include "wframecapturer_p.h"
+#include "woutputviewport.h"
+#include "woutputviewport_p.h"
+
+#include <qwbuffer.h>
+
+#include <QTimer>
+
+QW_USE_NAMESPACE
+WAYLIB_SERVER_BEGIN_NAMESPACE
+
+WFrameCapturerPrivate::~WFrameCapturerPrivate()
+{
+    dropPendingFrame();
+    if (sentBuffer)
+        sentBuffer->unlock();
+}
+
+void WFrameCapturerPrivate::onFrame(qw_buffer *buffer, const pixman_region32_t *damage)
+{
+    const QSize size(buffer->handle()->width, buffer->handle()->height);
+    if (needsWholeFrame || !damage || size != lastSentSize) {
+        pendingDamage.unite(QRect(QPoint(0, 0), size));
+        needsWholeFrame = false;
+    } else {
+        pixman_region32_union(pendingDamage, pendingDamage, damage);
+    }
+
+    // The contents are not changed since the last sent frame
+    if (pendingDamage.isEmpty())
+        return;
+
+    if (pendingBuffer != buffer) {
+        if (pendingBuffer)
+            pendingBuffer->unlock();
+        // Keep the buffer from reusing by the swapchain until it's sent and released
+        buffer->lock();
+        pendingBuffer = buffer;
+    }
+
+    scheduleSend();
+}
+
+void WFrameCapturerPrivate::attach()
+{
+    if (attached || !active || !viewport)
+        return;
+    attached = true;
+    needsWholeFrame = true;
+
+    auto vd = WOutputViewportPrivate::get(viewport);
+    vd->frameCapturers.append(q_func());
+    if (withCursor)
+        ++vd->cursorCaptureCount;
+    // Request a frame even if the contents are not changed
+    vd->update();
+}
+
+void WFrameCapturerPrivate::detach()
+{
+    if (!attached)
+        return;
+    attached = false;
+    dropPendingFrame();
+
+    if (!viewport)
+        return;
+
+    auto vd = WOutputViewportPrivate::get(viewport);
+    vd->frameCapturers.removeOne(q_func());
+    if (withCursor) {
+        Q_ASSERT(vd->cursorCaptureCount > 0);
+        // Allow to use the hardware layers again
+        if (--vd->cursorCaptureCount == 0)
+            vd->update();
+    }
+}
+
+// Only one frame is sent at a time, the later frames are merged to the pending
+// frame until the consumer releases the sent frame, and the frames are sent no
+// more often than maxFrameRate.
+void WFrameCapturerPrivate::scheduleSend()
+{
+    if (!pendingBuffer || sentBuffer || sendIsQueued)
+        return;
+
+    if (maxFrameRate > 0 && lastSentTime.isValid()) {
+        const qint64 interval = 1000 / maxFrameRate;
+        const qint64 elapsed = lastSentTime.elapsed();
+        if (elapsed < interval) {
+            if (!pacingTimer) {
+                W_Q(WFrameCapturer);
+                pacingTimer = new QTimer(q);
+                pacingTimer->setSingleShot(true);
+                pacingTimer->setTimerType(Qt::PreciseTimer);
+                QObject::connect(pacingTimer, &QTimer::timeout, q, [this] {
+                    scheduleSend();
+                });
+            }
+
+            if (!pacingTimer->isActive())
+                pacingTimer->start(interval - elapsed);
+            return;
+        }
+    }
+
+    // Don't send in the commit of the output, the consumer may change the scene
+    W_Q(WFrameCapturer);
+    sendIsQueued = true;
+    QMetaObject::invokeMethod(q, [this] {
+        sendIsQueued = false;
+        sendFrame();
+    }, Qt::QueuedConnection);
+}
+
+void WFrameCapturerPrivate::sendFrame()
+{
+    if (!pendingBuffer || sentBuffer)
+        return;
+
+    sentBuffer = pendingBuffer;
+    pendingBuffer = nullptr;
+    const QRegion damage = pendingDamage.toRegion();
+    pendingDamage.clear();
+    lastSentSize = QSize(sentBuffer->handle()->width, sentBuffer->handle()->height);
+    lastSentTime.start();
+
+    W_Q(WFrameCapturer);
+    Q_EMIT q->frameAvailable(sentBuffer, damage);
+}
+
+void WFrameCapturerPrivate::dropPendingFrame()
+{
+    if (pendingBuffer) {
+        pendingBuffer->unlock();
+        pendingBuffer = nullptr;
+    }
+    pendingDamage.clear();
+    if (pacingTimer)
+        pacingTimer->stop();
+}
+
+WFrameCapturer::WFrameCapturer(QObject *parent)
+    : QObject(parent)
+    , WObject(*new WFrameCapturerPrivate(this))
+{
+
+}
+
+WFrameCapturer::~WFrameCapturer()
+{
+    W_D(WFrameCapturer);
+    d->detach();
+}
+
+WOutputViewport *WFrameCapturer::viewport() const
+{
+    W_DC(WFrameCapturer);
+    return d->viewport;
+}
+
+void WFrameCapturer::setViewport(WOutputViewport *newViewport)
+{
+    W_D(WFrameCapturer);
+    if (d->viewport == newViewport)
+        return;
+    d->detach();
+    d->viewport = newViewport;
+    d->attach();
+    Q_EMIT viewportChanged();
+}
+
+bool WFrameCapturer::active() const
+{
+    W_DC(WFrameCapturer);
+    return d->active;
+}
+
+void WFrameCapturer::setActive(bool newActive)
+{
+    W_D(WFrameCapturer);
+    if (d->active == newActive)
+        return;
+    d->active = newActive;
+    if (d->active)
+        d->attach();
+    else
+        d->detach();
+    Q_EMIT activeChanged();
+}
+
+bool WFrameCapturer::withCursor() const
+{
+    W_DC(WFrameCapturer);
+    return d->withCursor;
+}
+
+void WFrameCapturer::setWithCursor(bool newWithCursor)
+{
+    W_D(WFrameCapturer);
+    if (d->withCursor == newWithCursor)
+        return;
+    d->detach();
+    d->withCursor = newWithCursor;
+    d->attach();
+    Q_EMIT withCursorChanged();
+}
+
+int WFrameCapturer::maxFrameRate() const
+{
+    W_DC(WFrameCapturer);
+    return d->maxFrameRate;
+}
+
+void WFrameCapturer::setMaxFrameRate(int newMaxFrameRate)
+{
+    W_D(WFrameCapturer);
+    newMaxFrameRate = qMax(0, newMaxFrameRate);
+    if (d->maxFrameRate == newMaxFrameRate)
+        return;
+    d->maxFrameRate = newMaxFrameRate;
+    Q_EMIT maxFrameRateChanged();
+}
+
+void WFrameCapturer::releaseFrame()
+{
+    W_D(WFrameCapturer);
+    if (!d->sentBuffer)
+        return;
+
+    d->sentBuffer->unlock();
+    d->sentBuffer = nullptr;
+    d->scheduleSend();
+}
+
+WAYLIB_SERVER_END_NAMESPACE
+
+#include "moc_wframecapturer.cpp"
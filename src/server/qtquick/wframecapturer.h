@@ -0,0 +1,63 @@
+// Copyright (C) 2024 JiDe Zhang <zhangjide@deepin.org>.
+// SPDX-License-Identifier: Apache-2.0 OR LGPL-3.0-only OR GPL-2.0-only OR GPL-3.0-only
+
+#pragma once
+
+#include <qwglobal.h>
+#include <wglobal.h>
+#include <QQuickItem>
+
+QW_BEGIN_NAMESPACE
+class qw_buffer;
+QW_END_NAMESPACE
+
+WAYLIB_SERVER_BEGIN_NAMESPACE
+
+class WOutputViewport;
+class WFrameCapturerPrivate;
+// Export the frames of a WOutputViewport without copy. The buffer is the one
+// committed to the output, or the one rendered by the WBufferRenderer if the
+// viewport is offscreen, a window can be captured by an offscreen viewport
+// whose input is the window.
+// The buffer of frameAvailable is locked until releaseFrame is called, the next
+// frame isn't sent before that, and the damage is relative to the last frame
+// sent by this capturer. The contents in the hardware planes aren't in the
+// buffer, enable withCursor to composite the cursor and the other layers into
+// the buffer while capturing.
+class WAYLIB_SERVER_EXPORT WFrameCapturer : public QObject, public WObject
+{
+    Q_OBJECT
+    W_DECLARE_PRIVATE(WFrameCapturer)
+    Q_PROPERTY(WOutputViewport* viewport READ viewport WRITE setViewport NOTIFY viewportChanged FINAL)
+    Q_PROPERTY(bool active READ active WRITE setActive NOTIFY activeChanged FINAL)
+    Q_PROPERTY(bool withCursor READ withCursor WRITE setWithCursor NOTIFY withCursorChanged FINAL)
+    Q_PROPERTY(int maxFrameRate READ maxFrameRate WRITE setMaxFrameRate NOTIFY maxFrameRateChanged FINAL)
+    QML_NAMED_ELEMENT(FrameCapturer)
+
+public:
+    explicit WFrameCapturer(QObject *parent = nullptr);
+    ~WFrameCapturer();
+
+    WOutputViewport *viewport() const;
+    void setViewport(WOutputViewport *newViewport);
+
+    bool active() const;
+    void setActive(bool newActive);
+
+    bool withCursor() const;
+    void setWithCursor(bool newWithCursor);
+
+    int maxFrameRate() const;
+    void setMaxFrameRate(int newMaxFrameRate);
+
+    Q_INVOKABLE void releaseFrame();
+
+Q_SIGNALS:
+    void viewportChanged();
+    void activeChanged();
+    void withCursorChanged();
+    void maxFrameRateChanged();
+    void frameAvailable(QW_NAMESPACE::qw_buffer *buffer, const QRegion &damage);
+};
+
+WAYLIB_SERVER_END_NAMESPACE
@@ -252,6 +252,14 @@ void WOutputHelper::setLayers(const wlr_output_layer_state_array &layers)
     }
 }
 
+// Returns true if any field of the output state is set for the next commit,
+// e.g. the buffer, the scale or the gamma LUT
+bool WOutputHelper::hasPendingState() const
+{
+    W_DC(WOutputHelper);
+    return d->state.committed != 0;
+}
+
 bool WOutputHelper::commit()
 {
     W_D(WOutputHelper);
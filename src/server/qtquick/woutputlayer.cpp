@@ -42,6 +42,7 @@ public:
     WOutputLayer::Flags flags = {0};
     int z = 0;
     QPointF cursorHotSpot;
+    QList<quint32> formats;
     QList<WOutputViewport*> outputs;
     QList<WOutputViewport*> inOutputsByHardware;
 };
@@ -283,6 +284,21 @@ void WOutputLayer::setCursorHotSpot(QPointF newCursorHotSpot)
     Q_EMIT cursorHotSpotChanged();
 }
 
+QList<quint32> WOutputLayer::formats() const
+{
+    W_DC(WOutputLayer);
+    return d->formats;
+}
+
+void WOutputLayer::setFormats(const QList<quint32> &newFormats)
+{
+    W_D(WOutputLayer);
+    if (d->formats == newFormats)
+        return;
+    d->formats = newFormats;
+    Q_EMIT formatsChanged();
+}
+
 void WOutputLayer::setAccepted(bool accepted)
 {
     W_D(WOutputLayer);
@@ -27,6 +27,7 @@ class WAYLIB_SERVER_EXPORT WOutputLayer : public QObject
     Q_PROPERTY(QList<WOutputViewport*> inOutputsByHardware READ inOutputsByHardware NOTIFY inOutputsByHardwareChanged FINAL)
     Q_PROPERTY(int z READ z WRITE setZ NOTIFY zChanged FINAL)
     Q_PROPERTY(QPointF cursorHotSpot READ cursorHotSpot WRITE setCursorHotSpot NOTIFY cursorHotSpotChanged FINAL)
+    Q_PROPERTY(QList<quint32> formats READ formats WRITE setFormats NOTIFY formatsChanged FINAL)
     QML_NAMED_ELEMENT(OutputLayer)
     QML_UNCREATABLE("OutputLayer is only available via attached properties")
     QML_ATTACHED(WOutputLayer)
@@ -71,6 +72,12 @@ public:
     QPointF cursorHotSpot() const;
     void setCursorHotSpot(QPointF newCursorHotSpot);
 
+    // The DRM fourcc codes of the buffer formats in the preferred order, the
+    // first format supported by both the renderer and the output is used.
+    // If it's empty, using ARGB8888, or XRGB8888 if the NoAlpha flag is set.
+    QList<quint32> formats() const;
+    void setFormats(const QList<quint32> &newFormats);
+
 Q_SIGNALS:
     void enabledChanged();
     void flagsChanged();
@@ -80,6 +87,7 @@ Q_SIGNALS:
     void keepLayerChanged();
     void forceChanged();
     void cursorHotSpotChanged();
+    void formatsChanged();
 
 private:
     void setAccepted(bool accepted);
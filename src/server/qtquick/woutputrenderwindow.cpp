@@ -15,6 +15,11 @@
 #include "weventjunkman.h"
 #include "winputdevice.h"
 #include "wseat.h"
+#include "wsurface.h"
+#include "wsurfaceitem.h"
+#include "wsgtextureprovider.h"
+#include "wsgtexturecache_p.h"
+#include "wframecapturer_p.h"
 
 #include "platformplugin/qwlrootsintegration.h"
 #include "platformplugin/qwlrootscreen.h"
@@ -39,7 +44,12 @@
 #include <QOpenGLFunctions>
 #include <QLoggingCategory>
 #include <QRunnable>
+#include <QBitArray>
+#include <QTimer>
+#include <QFile>
+#include <QAnimationDriver>
 #include <memory>
+#include <array>
 
 #define protected public
 #define private public
@@ -71,6 +81,7 @@ extern "C" {
 
 #include <drm_fourcc.h>
 #include <limits>
+#include <time.h>
 
 WAYLIB_SERVER_BEGIN_NAMESPACE
 
@@ -79,6 +90,58 @@ Q_LOGGING_CATEGORY(wlcRenderer, "waylib.server.renderer", QtDebugMsg)
 #else
 Q_LOGGING_CATEGORY(wlcRenderer, "waylib.server.renderer", QtWarningMsg)
 #endif
+// The same clock as the wlr_output_event_present::when
+inline static qint64 monotonicTime()
+{
+    timespec time;
+    clock_gettime(CLOCK_MONOTONIC, &time);
+    return time.tv_sec * 1000000000ll + time.tv_nsec;
+}
+
+enum FrameStage {
+    PolishStage,
+    SyncStage,
+    AnimatorStage,
+    RenderStage,
+    AfterRenderStage,
+    CompositeStage,
+    CommitStage,
+    FrameStageCount
+};
+
+static const char *frameStageName(FrameStage stage)
+{
+    switch (stage) {
+    case PolishStage: return "polish";
+    case SyncStage: return "sync";
+    case AnimatorStage: return "animator";
+    case RenderStage: return "render";
+    case AfterRenderStage: return "afterRender";
+    case CompositeStage: return "composite";
+    case CommitStage: return "commit";
+    default: break;
+    }
+
+    Q_UNREACHABLE_RETURN(nullptr);
+}
+
+struct Q_DECL_HIDDEN FrameStageTimes
+{
+    inline void reset() {
+        begin.fill(0);
+        duration.fill(0);
+    }
+    // Accumulate the time from "beginTime" to now
+    inline void add(FrameStage stage, qint64 beginTime) {
+        if (!begin[stage])
+            begin[stage] = beginTime;
+        duration[stage] += monotonicTime() - beginTime;
+    }
+
+    std::array<qint64, FrameStageCount> begin = {};
+    std::array<qint64, FrameStageCount> duration = {};
+};
+
 inline static void resetGlState()
 {
 #ifndef QT_NO_OPENGL
@@ -150,6 +213,13 @@ public:
         uint contentsIsDirty:1;
         // end
 
+        // The ratio of the frames that the layer is updated, for assignPlanes
+        qreal updateRate = 1.0;
+        // The buffer format negotiated from WOutputLayer::formats, it's
+        // DRM_FORMAT_INVALID if using the default format
+        QList<quint32> formats;
+        uint32_t format = DRM_FORMAT_INVALID;
+
         QRectF mapRect;
         QRectF noClipMapRect;
         QRect mapToOutput;
@@ -177,10 +247,21 @@ public:
     }
 
     inline void init() {
-        connect(this, &OutputHelper::requestRender, renderWindow(), qOverload<>(&WOutputRenderWindow::render));
+        // Only render this output on its frame event, the other outputs will
+        // render on their own frame events.
+        connect(this, &OutputHelper::requestRender, this, &OutputHelper::renderOnFrame);
         connect(this, &OutputHelper::damaged, renderWindow(), &WOutputRenderWindow::scheduleRender);
+        // The damage is from wlroots(e.g. the output is re-enabled), it's not in the scene graph
+        connect(this, &OutputHelper::damaged, this, [this] {
+            if (m_output)
+                bufferRenderer()->damageRing()->add_whole();
+            // Don't skip the render of the scene, and commit with the whole damage
+            m_primaryBufferIsValid = false;
+            m_lastCommitBuffer = nullptr;
+        });
         // TODO: pre update scale after WOutputHelper::setScale
         output()->output()->safeConnect(&WOutput::scaleChanged, this, &OutputHelper::updateSceneDPR);
+        output()->output()->safeConnect(&qw_output::notify_present, this, &OutputHelper::onPresent);
     }
 
     inline qw_output *qwoutput() const {
@@ -217,7 +298,26 @@ public:
         return m_output->devicePixelRatio();
     }
 
+    // WFrameCapturer::withCursor wants the cursor and the other layers in the buffer
+    inline bool disableHardwareLayers() const {
+        return output()->disableHardwareLayers()
+               || WOutputViewportPrivate::get(output())->cursorCaptureCount > 0;
+    }
+
     void updateSceneDPR();
+    void renderOnFrame();
+    void doRender();
+    qint64 renderDelay() const;
+
+    qint64 predictPresentTime(qint64 time) const;
+    void onPresent(wlr_output_event_present *event);
+    void markFrameCommitted(qint64 renderStartTime);
+    inline const WOutputRenderWindow::FrameStatistics &frameStatistics() const {
+        return m_frameStatistics;
+    }
+    inline FrameStageTimes &stageTimes() {
+        return m_stageTimes;
+    }
 
     int indexOfLayer(OutputLayer *layer) const;
     LayerData *getLayer(OutputLayer *layer) const;
@@ -238,10 +338,16 @@ public:
         return on;
     }
 
+    bool tryToDirectScanout();
+    bool canSkipRenderOutput() const;
+    void renderOutput();
     qw_buffer *renderLayer(LayerData *layer, bool *dontEndRenderAndReturnNeedsEndRender);
     WBufferRenderer *afterRender();
+    QBitArray assignPlanes(wlr_output_layer_state_array &layers, const QList<LayerData*> &datas);
     WBufferRenderer *compositeLayers(const QVector<LayerData*> layers, bool forceShadowRenderer);
     bool commit(WBufferRenderer *buffer);
+    void captureFrame(WBufferRenderer *renderer, qw_buffer *buffer);
+    bool doCommit();
     bool tryToHardwareCursor(const LayerData *layer);
 
 private:
@@ -253,6 +359,60 @@ private:
     BufferRendererProxy *m_cursorLayerProxy = nullptr;
     bool m_cursorDirty = false;
     bool m_hardwareCursorRenderComplete = false;
+    // The buffer and hotspot in the cursor plane, skip set_cursor if not changed
+    QPointer<qw_buffer> m_hardwareCursorBuffer;
+    QPoint m_hardwareCursorHotSpot;
+    // the client buffer will commit to the output directly
+    QPointer<qw_buffer> m_scanoutBuffer;
+    bool m_directScanout = false;
+
+    // for the cursor-only frames
+    // The last buffer of bufferRenderer has the scene of the last renderOutput
+    bool m_primaryBufferIsValid = false;
+    // The software layers are composited to the buffers of bufferRenderer, the
+    // buffers can't be the background of the layers in the cursor-only frames.
+    bool m_layersInPrimaryBuffer = false;
+    // The whole scene is damaged to remove the layers from the primary buffer,
+    // the primary buffer is clean after the next renderOutput.
+    bool m_cleaningPrimaryBuffer = false;
+    // The renderer of the last frame sent to the WFrameCapturers, its damage
+    // ring has the damage relative to that frame
+    WBufferRenderer *m_lastCaptureRenderer = nullptr;
+
+    WOutputRenderWindow::FrameStatistics m_frameStatistics;
+    FrameStageTimes m_stageTimes;
+    // The vblank predicted at the last commit
+    qint64 m_targetPresentTime = 0;
+
+    // for late latching
+    QTimer *m_renderDelayTimer = nullptr;
+    std::array<qint64, 16> m_renderDurations = {};
+    int m_renderDurationIndex = 0;
+    // Don't delay the render in the next frames, it's for the missed frames
+    int m_renderDelayBackoff = 0;
+    bool m_renderIsDelayed = false;
+    bool m_committedFrameIsDelayed = false;
+
+    // for assignPlanes, it's reused until the layers or their properties are changed
+    struct PlaneLayerKey {
+        OutputLayer *layer;
+        QRect mapToOutput;
+        // The flags and formats change the buffer of the layer
+        WOutputLayer::Flags flags;
+        QList<quint32> formats;
+        bool keepLayer;
+        bool forceLayer;
+
+        bool operator==(const PlaneLayerKey &other) const = default;
+    };
+    struct PlaneAssignment {
+        QList<PlaneLayerKey> layers;
+        QBitArray hardware;
+        bool disableHardwareLayers = false;
+        // The planes are tested with the client buffer in direct scanout
+        bool scanout = false;
+        bool valid = false;
+    } m_planeAssignment;
 
     // for compositeLayers
     QPointer<WOutputViewport> m_output2;
@@ -367,6 +527,68 @@ public:
     QWindow *m_renderWindow = nullptr;
 };
 
+// Advance the animations by the frame clock of the outputs instead of a timer,
+// the animations are sampled at the predicted presentation time of the frame
+// in rendering, see WOutputRenderWindowPrivate::advanceAnimations. If no output
+// is rendering, e.g. the animated items aren't visible on any output, the
+// animations are advanced by a fallback timer, so they still finish in time.
+class Q_DECL_HIDDEN FrameClockAnimationDriver : public QAnimationDriver
+{
+public:
+    explicit FrameClockAnimationDriver(WOutputRenderWindow *window)
+        : QAnimationDriver(window)
+        , m_window(window)
+    {
+        m_fallbackTimer.setTimerType(Qt::PreciseTimer);
+        m_fallbackTimer.setInterval(FallbackInterval);
+        QObject::connect(&m_fallbackTimer, &QTimer::timeout, this, [this] {
+            const qint64 now = monotonicTime();
+            if (now - m_lastAdvanceTime >= FallbackInterval * 2 * 1000000ll)
+                advanceOutOfRendering(now);
+        });
+    }
+
+    // in milliseconds since the driver started
+    qint64 elapsed() const override {
+        return isRunning() ? (m_time - m_startTime) / 1000000 : 0;
+    }
+
+    // The time is in nanoseconds of CLOCK_MONOTONIC, the outputs have the
+    // different frame clocks, never go back to keep the animations monotonic.
+    void advanceTo(qint64 time) {
+        if (!isRunning())
+            return;
+        m_time = qMax(m_time, time);
+        m_lastAdvanceTime = monotonicTime();
+        advance();
+    }
+
+protected:
+    void start() override {
+        m_startTime = m_time = m_lastAdvanceTime = monotonicTime();
+        QAnimationDriver::start();
+        m_fallbackTimer.start();
+        // The first frame will find out which outputs show the animations
+        m_window->scheduleRender();
+    }
+
+    void stop() override {
+        m_fallbackTimer.stop();
+        QAnimationDriver::stop();
+    }
+
+private:
+    void advanceOutOfRendering(qint64 time);
+
+    static constexpr int FallbackInterval = 16;
+
+    WOutputRenderWindow *m_window;
+    QTimer m_fallbackTimer;
+    qint64 m_startTime = 0;
+    qint64 m_time = 0;
+    qint64 m_lastAdvanceTime = 0;
+};
+
 static QEvent::Type doRenderEventType = static_cast<QEvent::Type>(QEvent::registerEventType());
 class Q_DECL_HIDDEN WOutputRenderWindowPrivate : public QQuickWindowPrivate
 {
@@ -425,6 +647,27 @@ public:
 
     QVector<std::pair<OutputHelper *, WBufferRenderer *>>
     doRenderOutputs(const QList<OutputHelper *> &outputs, bool forceRender);
+    void beginFrame();
+    void endFrame();
+    void commitOutputs(const QVector<std::pair<OutputHelper*, WBufferRenderer*>> &outputs);
+    void recordFrameTiming(OutputHelper *helper);
+    void writeFrameTrace(const WOutputRenderWindow::FrameTiming &timing,
+                         const FrameStageTimes &outputStageTimes);
+    static QString frameTraceFileName() {
+        static QString fileName = qEnvironmentVariable("WAYLIB_FRAME_TRACE");
+        return fileName;
+    }
+    bool animatorIsRunning() const;
+    void advanceAnimations(const QList<OutputHelper*> &outputs);
+    void advanceAnimationsOutOfRendering(qint64 time);
+    void collectAnimatedItems();
+    void updateAnimatedOutputs();
+    bool isCursorOnlyFrame() const;
+    inline bool cursorIsMoving() const {
+        // Keep the state of moving for a while, the pointer motion is discontinuous
+        constexpr quint64 movingFrames = 60;
+        return lastCursorOnlyFrame > 0 && frameNumber - lastCursorOnlyFrame < movingFrames;
+    }
     void doRender(const QList<OutputHelper*> &outputs, bool forceRender, bool doCommit);
     inline void doRender() {
         doRender(outputs, false, true);
@@ -448,13 +691,40 @@ public:
 
     bool componentCompleted = true;
     bool inRendering = false;
+    qint64 renderStartTime = 0;
 
     QPointer<qw_renderer> m_renderer;
     QPointer<qw_allocator> m_allocator;
 
     QList<OutputHelper*> outputs;
     QList<OutputLayer*> layers;
+    std::unique_ptr<WSGTextureCache> textureCache;
+
+    // for the animations, see advanceAnimations
+    FrameClockAnimationDriver *animationDriver = nullptr;
+    bool animationsAdvanced = false;
+    // The sceneChanged is ignored like in rendering, see advanceAnimationsOutOfRendering
+    bool advancingAnimations = false;
+    QList<QQuickItem*> animatedItems;
+    // The bounding rects in the scene of the items animated in the last frame
+    QHash<QQuickItem*, QRectF> animatedItemRects;
+
+    // for the cursor-only frames, see isCursorOnlyFrame
+    bool cursorOnlyFrame = false;
+    quint64 lastCursorOnlyFrame = 0;
+
+    // for frame timing
+    quint64 frameNumber = 0;
+    FrameStageTimes stageTimes;
+    qint64 gpuDuration = -1;
+    int frameTimingCapacity = 0;
+    // It's a ring buffer if the size reaches the frameTimingCapacity
+    QList<WOutputRenderWindow::FrameTiming> frameTimings;
+    int frameTimingNext = 0;
+    std::unique_ptr<QFile> frameTraceFile;
     bool disableLayers = false;
+    bool lateLatching = false;
+    int renderSafetyMargin = 2000;
 
     QOpenGLContext *glContext = nullptr;
 #ifdef ENABLE_VULKAN_RENDER
@@ -474,6 +744,140 @@ void OutputHelper::updateSceneDPR()
     WOutputRenderWindowPrivate::get(renderWindow())->updateSceneDPR();
 }
 
+void OutputHelper::renderOnFrame()
+{
+    if (!renderWindowD()->isInitialized())
+        return;
+
+    // Delay the render to just before the next vblank, so the input events and
+    // the clients' commits are sampled as late as possible.
+    const qint64 delay = contentIsDirty() ? renderDelay() : 0;
+    if (delay >= 1000000) {
+        if (!m_renderDelayTimer) {
+            m_renderDelayTimer = new QTimer(this);
+            m_renderDelayTimer->setSingleShot(true);
+            m_renderDelayTimer->setTimerType(Qt::PreciseTimer);
+            connect(m_renderDelayTimer, &QTimer::timeout, this, [this] {
+                m_renderIsDelayed = true;
+                doRender();
+                m_renderIsDelayed = false;
+            });
+        }
+
+        m_renderDelayTimer->start(std::chrono::milliseconds(delay / 1000000));
+        return;
+    }
+
+    doRender();
+}
+
+void OutputHelper::doRender()
+{
+    if (m_renderDelayTimer)
+        m_renderDelayTimer->stop();
+
+    auto d = renderWindowD();
+    if (d->inRendering) {
+        // Will render in the next loop
+        d->scheduleDoRender();
+        return;
+    }
+
+    d->doRender({this}, false, true);
+}
+
+// Returns how long the render can be delayed from now, in nanoseconds
+qint64 OutputHelper::renderDelay() const
+{
+    if (!renderWindow()->lateLatching() || m_renderDelayBackoff > 0)
+        return 0;
+
+    const qint64 now = monotonicTime();
+    const qint64 nextPresentTime = predictPresentTime(now);
+    if (nextPresentTime <= 0)
+        return 0;
+
+    // Use the slowest of the recent frames, a bit later is better than a missed frame
+    const qint64 renderDuration = *std::max_element(m_renderDurations.cbegin(),
+                                                    m_renderDurations.cend());
+    if (renderDuration <= 0)
+        return 0;
+
+    const qint64 margin = renderWindow()->renderSafetyMargin() * 1000ll;
+    return nextPresentTime - renderDuration - margin - now;
+}
+
+qint64 OutputHelper::predictPresentTime(qint64 time) const
+{
+    const auto &s = m_frameStatistics;
+    if (s.refreshInterval <= 0 || s.lastPresentTime <= 0)
+        return 0;
+
+    const qint64 frames = qMax((time - s.lastPresentTime) / s.refreshInterval + 1, 1ll);
+    return s.lastPresentTime + frames * s.refreshInterval;
+}
+
+void OutputHelper::onPresent(wlr_output_event_present *event)
+{
+    if (!event->presented)
+        return;
+
+#if WLR_VERSION_MINOR > 17
+    const timespec &when = event->when;
+#else
+    const timespec &when = *event->when;
+#endif
+    const qint64 presentTime = when.tv_sec * 1000000000ll + when.tv_nsec;
+    auto &s = m_frameStatistics;
+
+    if (event->refresh > 0) {
+        s.refreshInterval = event->refresh;
+    } else if (qwoutput()->handle()->refresh > 0) {
+        // The refresh rate is in mHz
+        s.refreshInterval = 1000000000000ll / qwoutput()->handle()->refresh;
+    } else {
+        s.refreshInterval = 0;
+    }
+
+    if (m_targetPresentTime > 0
+        && presentTime > m_targetPresentTime + s.refreshInterval / 2) {
+        ++s.missedFrames;
+
+        if (m_committedFrameIsDelayed) {
+            // Render as soon as possible for a while
+            m_renderDelayBackoff = 120;
+            qCDebug(wlcRenderer) << "The delayed frame is missed, stop the late latching for"
+                                 << m_renderDelayBackoff << "frames on" << output();
+        }
+    }
+    m_targetPresentTime = 0;
+    m_committedFrameIsDelayed = false;
+
+    s.lastPresentTime = presentTime;
+    ++s.presentedFrames;
+}
+
+void OutputHelper::markFrameCommitted(qint64 renderStartTime)
+{
+    const qint64 now = monotonicTime();
+    auto &s = m_frameStatistics;
+
+    s.lastRenderDuration = now - renderStartTime;
+    if (s.averageRenderDuration > 0) {
+        s.averageRenderDuration = (s.averageRenderDuration * 7 + s.lastRenderDuration) / 8;
+    } else {
+        s.averageRenderDuration = s.lastRenderDuration;
+    }
+    ++s.committedFrames;
+    m_targetPresentTime = predictPresentTime(now);
+
+    m_renderDurations[m_renderDurationIndex] = s.lastRenderDuration;
+    m_renderDurationIndex = (m_renderDurationIndex + 1) % m_renderDurations.size();
+    m_committedFrameIsDelayed = m_renderIsDelayed;
+    if (m_renderDelayBackoff > 0)
+        --m_renderDelayBackoff;
+}
+
 int OutputHelper::indexOfLayer(OutputLayer *layer) const
 {
     for (int i = 0; i < m_layers.count(); ++i)
@@ -606,6 +1010,174 @@ static inline QRectF scaleRect(const QRectF &r, qreal xScale, qreal yScale) {
     return QRectF(r.x() * xScale, r.y() * yScale, r.width() * xScale, r.height() * yScale);
 }
 
+// Find the topmost item that paints something inside the outputRect, walks
+// the items in the reverse paint order. The items hidden by the effect (e.g.
+// accepted by WOutputLayer) is ignored, they are not painted in this scene.
+static QQuickItem *topmostContentItem(WOutputViewport *viewport, QQuickItem *item,
+                                      const QRectF &outputRect)
+{
+    auto d = QQuickItemPrivate::get(item);
+    if (!d->effectiveVisible || qFuzzyIsNull(item->opacity()))
+        return nullptr;
+    if (d->extra.isAllocated() && d->extra->hideRefCount > 0)
+        return nullptr;
+    if (item->clip() && !viewport->mapToOutput(item, item->boundingRect()).intersects(outputRect))
+        return nullptr;
+
+    const auto children = d->paintOrderChildItems();
+    int i = children.size() - 1;
+    // The children with negative z value are painted under the parent
+    for (; i >= 0 && children.at(i)->z() >= 0; --i) {
+        if (auto target = topmostContentItem(viewport, children.at(i), outputRect))
+            return target;
+    }
+
+    if (item->flags().testFlag(QQuickItem::ItemHasContents)
+        && viewport->mapToOutput(item, item->boundingRect()).intersects(outputRect)) {
+        return item;
+    }
+
+    for (; i >= 0; --i) {
+        if (auto target = topmostContentItem(viewport, children.at(i), outputRect))
+            return target;
+    }
+
+    return nullptr;
+}
+
+bool OutputHelper::tryToDirectScanout()
+{
+    m_scanoutBuffer = nullptr;
+
+    static bool noDirectScanout = qEnvironmentVariableIsSet("WAYLIB_NO_DIRECT_SCANOUT");
+    if (noDirectScanout)
+        return false;
+
+    // The contents of the WBufferRenderer is needed by others
+    if (output()->offscreen()
+        || bufferRenderer()->shouldCacheBuffer()
+        || !output()->depends().isEmpty()) {
+        return false;
+    }
+
+    if (qwoutput()->handle()->transform != WL_OUTPUT_TRANSFORM_NORMAL)
+        return false;
+
+    const QSize pixelSize = output()->output()->size();
+    const QRectF outputRect(QPointF(0, 0), QSizeF(pixelSize) / devicePixelRatio());
+    QQuickItem *root = output()->input() ? output()->input() : renderWindow()->contentItem();
+    auto content = qobject_cast<WSurfaceItemContent*>(topmostContentItem(output(), root, outputRect));
+    if (!content || !content->surface())
+        return false;
+
+    auto buffer = content->wTextureProvider()->qwBuffer();
+    if (!buffer || QSize(buffer->handle()->width, buffer->handle()->height) != pixelSize)
+        return false;
+
+    auto surface = content->surface()->handle();
+    if (surface->handle()->current.transform != WL_OUTPUT_TRANSFORM_NORMAL)
+        return false;
+    // Must be opaque, there is nothing under the buffer on the output
+    const QSize surfaceSize = content->surface()->size();
+    pixman_box32_t surfaceBox { 0, 0, surfaceSize.width(), surfaceSize.height() };
+    if (pixman_region32_contains_rectangle(&surface->handle()->opaque_region, &surfaceBox)
+        != PIXMAN_REGION_IN) {
+        return false;
+    }
+
+    qw_fbox sourceBox;
+    surface->get_buffer_source_box(sourceBox);
+    if (sourceBox.toQRectF() != QRectF(QPointF(0, 0), pixelSize))
+        return false;
+
+    // The buffer must be shown on the output without any transform except translate and scale
+    const auto matrix = output()->mapToViewport(content) * output()->sourceRectToTargetRectTransfrom();
+    const auto transform = matrix.toTransform();
+    if (transform.type() > QTransform::TxScale || transform.m11() <= 0 || transform.m22() <= 0)
+        return false;
+    const QRectF geometry(content->ignoreBufferOffset() ? QPointF() : content->bufferOffset(),
+                          content->size());
+    if (scaleRect(matrix.mapRect(geometry), devicePixelRatio(), devicePixelRatio()).toRect()
+        != QRect(QPoint(0, 0), pixelSize)) {
+        return false;
+    }
+
+    for (auto item = static_cast<QQuickItem*>(content); item && item != root; item = item->parentItem()) {
+        if (item->opacity() < 1.0)
+            return false;
+        auto d = QQuickItemPrivate::get(item);
+        if (d->layer() && d->layer()->enabled())
+            return false;
+        if (item != content && item->clip()
+            && !output()->mapToOutput(item, item->boundingRect()).contains(outputRect)) {
+            return false;
+        }
+    }
+
+    if (!WOutputHelper::testCommit(buffer, {})) {
+        if (m_directScanout)
+            qCDebug(wlcRenderer) << "Direct scanout is stopped by test commit failed on" << output();
+        m_directScanout = false;
+        return false;
+    }
+
+    if (!m_directScanout)
+        qCDebug(wlcRenderer) << "Direct scanout" << content << "on" << output();
+    m_directScanout = true;
+    m_scanoutBuffer = buffer;
+
+    return true;
+}
+
+// In the cursor-only frames, the scene isn't changed since the last render of
+// this output, keep the last buffer of the scene and only composite the layers
+// on it by the shadow renderer. It requires the layers are not composited in
+// the last buffer, see afterRender.
+bool OutputHelper::canSkipRenderOutput() const
+{
+    auto d = renderWindowD();
+    if (!d->cursorOnlyFrame || m_directScanout || m_layersInPrimaryBuffer)
+        return false;
+
+    // The scene graph may be changed out of the sync, e.g. the texture of a
+    // node is changed, so check the damage of the scene instead of the items.
+    return m_primaryBufferIsValid && bufferRenderer()->lastBuffer()
+           && !bufferRenderer()->sourceIsDirty(0);
+}
+
+void OutputHelper::renderOutput()
+{
+    if (m_directScanout) {
+        qCDebug(wlcRenderer) << "Direct scanout is stopped on" << output();
+        m_directScanout = false;
+    }
+
+    const auto &format = qwoutput()->handle()->render_format;
+    const auto renderMatrix = output()->renderMatrix();
+
+    // maybe using the other WOutputViewport's QSGTextureProvider
+    if (!output()->depends().isEmpty())
+        renderWindowD()->updateDirtyNodes();
+
+    qw_buffer *buffer = beginRender(bufferRenderer(), output()->output()->size(), format,
+                                    WBufferRenderer::RedirectOpenGLContextDefaultFrameBufferObject);
+    Q_ASSERT(buffer == bufferRenderer()->currentBuffer());
+    if (buffer) {
+        render(bufferRenderer(), 0, renderMatrix,
+               output()->effectiveSourceRect(),
+               output()->targetRect(),
+               output()->preserveColorContents());
+
+        m_primaryBufferIsValid = true;
+        if (m_cleaningPrimaryBuffer) {
+            m_cleaningPrimaryBuffer = false;
+            m_layersInPrimaryBuffer = false;
+        }
+    } else {
+        m_primaryBufferIsValid = false;
+    }
+}
+
 qw_buffer *OutputHelper::renderLayer(LayerData *layer, bool *dontEndRenderAndReturnNeedsEndRender)
 {
     auto source = layer->layer->layer->parent();
@@ -727,9 +1299,17 @@ qw_buffer *OutputHelper::renderLayer(LayerData *layer, bool *dontEndRenderAndRet
         std::swap(pixelSize, layer->pixelSize);
         std::swap(renderMatrix, layer->renderMatrix);
 
+        // Only the position is changed if the layer is moved without clip, the
+        // contents of the buffer is same, keep using the last buffer and only
+        // update mapToOutput. The translate of renderMatrix has been removed
+        // above, but it may have the tiny floating point errors, so using the
+        // fuzzy compare for it.
+        const QPointF sourceOffset = mapRect.topLeft() - noClipMapRect.topLeft();
+        const QPointF newSourceOffset = layer->mapRect.topLeft() - layer->noClipMapRect.topLeft();
         if (layer->pixelSize != pixelSize
             || layer->mapRect.size() != mapRect.size()
-            || layer->renderMatrix != renderMatrix) {
+            || sourceOffset != newSourceOffset
+            || !qFuzzyCompare(layer->renderMatrix, renderMatrix)) {
             layer->contentsIsDirty = true;
         }
     }
@@ -737,14 +1317,33 @@ qw_buffer *OutputHelper::renderLayer(LayerData *layer, bool *dontEndRenderAndRet
     layer->mapToOutput = QRect((layer->mapRect.topLeft() * dpr).toPoint(), layer->pixelSize);
     auto buffer = layer->renderer->lastBuffer();
 
-    if (!buffer || layer->contentsIsDirty) {
+    const auto formats = layer->layer->layer->formats();
+    if (layer->formats != formats) {
+        layer->formats = formats;
+        layer->format = formats.isEmpty() ? DRM_FORMAT_INVALID
+                                          : output()->output()->pickFormat(formats);
+        layer->contentsIsDirty = true;
+
+        if (layer->format == DRM_FORMAT_INVALID && !formats.isEmpty()) {
+            qCWarning(wlcRenderer) << "No format of" << formats << "is supported for the layer"
+                                   << layer->layer->layer << ", fallback to the default format";
+        }
+    }
+
+    const bool updated = !buffer || layer->contentsIsDirty;
+    layer->updateRate = layer->updateRate * 7 / 8 + (updated ? 1.0 / 8 : 0);
+
+    if (updated) {
         layer->renderer->setSize(layer->pixelSize / dpr);
 
-        const bool alpha = !layer->layer->layer->flags().testFlag(WOutputLayer::NoAlpha);
+        uint32_t format = layer->format;
+        if (format == DRM_FORMAT_INVALID) {
+            const bool alpha = !layer->layer->layer->flags().testFlag(WOutputLayer::NoAlpha);
+            format = alpha ? DRM_FORMAT_ARGB8888 : DRM_FORMAT_XRGB8888;
+        }
+
         // Don't use OutputHelper::beginRender, because the dpr maybe is from LayerData::mapFrom
-        buffer = layer->renderer->beginRender(layer->pixelSize, dpr,
-                                              // TODO: Allows control format by WOutputLayer
-                                              alpha ? DRM_FORMAT_ARGB8888 : DRM_FORMAT_XRGB8888,
+        buffer = layer->renderer->beginRender(layer->pixelSize, dpr, format,
                                               WBufferRenderer::DontConfigureSwapchain);
         if (buffer) {
             const QRectF sr = QRectF(layer->mapRect.topLeft() - layer->noClipMapRect.topLeft(), layer->mapRect.size());
@@ -846,17 +1445,16 @@ WBufferRenderer *OutputHelper::afterRender()
     }
 
     static bool noHardwareLayers = qEnvironmentVariableIsSet("WAYLIB_NO_HARDWARE_LAYERS");
-    const bool ok = !noHardwareLayers && WOutputHelper::testCommit(bufferRenderer()->currentBuffer(), layers);
-    int needsSoftwareCompositeBeginIndex = -1;
-    int needsSoftwareCompositeEndIndex = -1;
+    QBitArray hardware = noHardwareLayers ? QBitArray(layers.size())
+                                          : assignPlanes(layers, needsCompositeLayers);
     bool forceShadowRender = false;
     bool hasHardwareCursor = false;
 
     {
         // try fallback to cursor plane for the top layer
         auto topLayer = needsCompositeLayers.last();
-        if ((!output()->disableHardwareLayers() || topLayer->layer->forceLayer())
-            && !(ok && layers.last().accepted)
+        if ((!disableHardwareLayers() || topLayer->layer->forceLayer())
+            && !hardware.testBit(layers.size() - 1)
             && (topLayer->layer->layer->flags() & WOutputLayer::Cursor)) {
             if (tryToHardwareCursor(topLayer)) {
                 Q_ASSERT(topLayer->renderer->lastBuffer()->handle() == layers.last().buffer);
@@ -866,33 +1464,24 @@ WBufferRenderer *OutputHelper::afterRender()
                 Q_ASSERT(ok);
                 needsCompositeLayers.removeLast();
                 layers.removeLast();
+                hardware.resize(layers.size());
             }
         }
     }
 
     Q_ASSERT(needsCompositeLayers.size() == layers.size());
+    wlr_output_layer_state_array hardwareLayers;
+    int softwareBeginIndex = -1;
+    int softwareEndIndex = -1;
     for (int i = layers.length() - 1; i >= 0; --i) {
-        const auto &state = layers.at(i);
-        Q_ASSERT(state.buffer);
+        Q_ASSERT(layers.at(i).buffer);
         OutputLayer *layer = needsCompositeLayers[i]->layer;
 
-        // If hardware layers is disabled on this output viewport
-        // and this layer doesn't want force layer, should fallback
-        // to software composite.
-        if (needsSoftwareCompositeEndIndex == -1
-            && output()->disableHardwareLayers()
-            && !layer->forceLayer()) {
-            needsSoftwareCompositeEndIndex = i;
-        }
-
-        if (needsSoftwareCompositeEndIndex == -1) {
-            if (ok && state.accepted) {
-                bool ok = layer->accept(output(), true);
-                Q_ASSERT(ok);
-                continue;
-            } else {
-                needsSoftwareCompositeEndIndex = i;
-            }
+        if (hardware.testBit(i)) {
+            bool ok = layer->accept(output(), true);
+            Q_ASSERT(ok);
+            hardwareLayers.prepend(layers.at(i));
+            continue;
         }
 
         if (layer->forceLayer() || layer->keepLayer()
@@ -904,7 +1493,9 @@ WBufferRenderer *OutputHelper::afterRender()
             Q_ASSERT(ok);
             if (layer->forceLayer())
                 forceShadowRender = true;
-            needsSoftwareCompositeBeginIndex = i;
+            softwareBeginIndex = i;
+            if (softwareEndIndex < 0)
+                softwareEndIndex = i;
         } else if (!output()->ignoreSoftwareLayers()) {
             bool ok = layer->reject(output());
             Q_ASSERT(ok);
@@ -917,18 +1508,12 @@ WBufferRenderer *OutputHelper::afterRender()
         // Don't cleanCursorRender(), maybe will use in next frame
     }
 
-    if (needsSoftwareCompositeEndIndex == -1) // All layers need software composite
-        needsSoftwareCompositeEndIndex = needsCompositeLayers.size() - 1;
-    const int needsCompositeCount = needsSoftwareCompositeBeginIndex >= 0
-                                        ? needsSoftwareCompositeEndIndex - needsSoftwareCompositeBeginIndex + 1
-                                        : 0;
-    if (needsCompositeCount > 0) {
-        Q_ASSERT(layers.size() == needsCompositeLayers.size());
-        // Don't use needsCompositeCount, rejected layers also should remove
-        layers.remove(0, needsSoftwareCompositeEndIndex + 1);
-
-        needsCompositeLayers = needsCompositeLayers.mid(needsSoftwareCompositeBeginIndex,
-                                                        needsCompositeCount);
+    layers = hardwareLayers;
+    // Keep the rejected layers between the software layers, they are drawn
+    // in the normal scene and are composited again to keep the stacking order.
+    if (softwareBeginIndex >= 0) {
+        needsCompositeLayers = needsCompositeLayers.mid(softwareBeginIndex,
+                                                        softwareEndIndex - softwareBeginIndex + 1);
     } else {
         needsCompositeLayers.clear();
     }
@@ -943,7 +1528,179 @@ WBufferRenderer *OutputHelper::afterRender()
         return bufferRenderer();
     }
 
-    return compositeLayers(needsCompositeLayers, forceShadowRender);
+    if (m_scanoutBuffer) {
+        // The layers can't composite to the client buffer, fallback to render the scene
+        m_scanoutBuffer = nullptr;
+        renderOutput();
+    }
+
+    // Keep the layers out of the primary buffer when the software cursor is moving,
+    // the next cursor-only frames can composite the layers on the last primary buffer.
+    if (renderWindowD()->cursorIsMoving()
+        && std::any_of(needsCompositeLayers.cbegin(), needsCompositeLayers.cend(),
+                       [] (const LayerData *layer) {
+            return layer->layer->layer->flags().testFlag(WOutputLayer::Cursor);
+        })) {
+        if (!m_layersInPrimaryBuffer) {
+            forceShadowRender = true;
+        } else if (!m_cleaningPrimaryBuffer) {
+            // The layers of the last frames are still in the buffers, render
+            // the whole scene in the next frame to clean them.
+            bufferRenderer()->damageRing()->add_whole();
+            m_cleaningPrimaryBuffer = true;
+        }
+    }
+
+    const qint64 compositeBegin = monotonicTime();
+    auto renderer = compositeLayers(needsCompositeLayers, forceShadowRender);
+    m_stageTimes.add(CompositeStage, compositeBegin);
+
+    return renderer;
+}
+
+// Choose the layers for the hardware planes, the layers are sorted from bottom
+// to top, returns the bits of the layers in the hardware planes. The layers
+// not in the planes are rendered to the primary buffer, which is below all
+// planes, so a layer can be in a plane only if it doesn't overlap the layers
+// above it that are not in the planes. A layer is scored by its area and how
+// often it's updated, the test commits are limited for a frame, and the result
+// is reused without the test commits until the layers are changed.
+QBitArray OutputHelper::assignPlanes(wlr_output_layer_state_array &layers, const QList<LayerData*> &datas)
+{
+    Q_ASSERT(layers.size() == datas.size());
+    const int count = layers.size();
+
+    QList<PlaneLayerKey> key;
+    key.reserve(count);
+    for (const auto data : datas) {
+        const WOutputLayer *layer = data->layer->layer;
+        key.append({data->layer, data->mapToOutput, layer->flags(), layer->formats(),
+                    data->layer->keepLayer(), data->layer->forceLayer()});
+    }
+    const bool scanout = bool(m_scanoutBuffer);
+
+    if (m_planeAssignment.valid && m_planeAssignment.layers == key
+        && m_planeAssignment.disableHardwareLayers == disableHardwareLayers()
+        && m_planeAssignment.scanout == scanout) {
+        for (int i = 0; i < count; ++i)
+            layers[i].accepted = m_planeAssignment.hardware.testBit(i);
+        return m_planeAssignment.hardware;
+    }
+
+    auto score = [&] (int index) {
+        const QRect &rect = datas.at(index)->mapToOutput;
+        // The static layers also save the compositing when the other contents is changed
+        return qreal(rect.width()) * rect.height() * (0.1 + datas.at(index)->updateRate);
+    };
+    auto totalScore = [&] (const QBitArray &bits) {
+        qreal total = 0;
+        for (int i = 0; i < count; ++i) {
+            if (bits.testBit(i))
+                total += score(i);
+        }
+        return total;
+    };
+    // Move the layers overlapping a software layer above them to the software
+    auto makeValid = [&] (QBitArray bits) {
+        QRegion softwareRegion;
+        for (int i = count - 1; i >= 0; --i) {
+            if (bits.testBit(i) && !softwareRegion.intersects(datas.at(i)->mapToOutput))
+                continue;
+            bits.clearBit(i);
+            softwareRegion += datas.at(i)->mapToOutput;
+        }
+        return bits;
+    };
+    auto test = [&] (const QBitArray &bits, QBitArray *accepted) {
+        wlr_output_layer_state_array states;
+        QVarLengthArray<int> indexes;
+        for (int i = 0; i < count; ++i) {
+            if (!bits.testBit(i))
+                continue;
+            states.append(layers.at(i));
+            states.last().accepted = false;
+            indexes.append(i);
+        }
+
+        *accepted = QBitArray(count);
+        auto buffer = m_scanoutBuffer ? m_scanoutBuffer.get() : bufferRenderer()->currentBuffer();
+        if (!WOutputHelper::testCommit(buffer, states))
+            return false;
+        for (int i = 0; i < states.size(); ++i) {
+            if (states.at(i).accepted)
+                accepted->setBit(indexes.at(i));
+        }
+        return true;
+    };
+
+    QBitArray candidates(count);
+    for (int i = 0; i < count; ++i) {
+        if (!disableHardwareLayers() || datas.at(i)->layer->forceLayer())
+            candidates.setBit(i);
+    }
+
+    constexpr int maxTestCommits = 3;
+    QBitArray best(count);
+    qreal bestScore = 0;
+    QBitArray swapTried(count);
+    QBitArray bits = makeValid(candidates);
+    bool tested = false;
+
+    for (int tests = 0; tests < maxTestCommits && bits.count(true) > 0; ++tests) {
+        QBitArray accepted;
+        tested |= test(bits, &accepted);
+
+        if (accepted == bits) {
+            const qreal s = totalScore(bits);
+            if (s > bestScore) {
+                best = bits;
+                bestScore = s;
+            }
+
+            // The planes are not enough, try to swap the lowest scored layer
+            // in the planes with the highest scored layer not in the planes.
+            int in = -1, out = -1;
+            for (int i = 0; i < count; ++i) {
+                if (best.testBit(i)) {
+                    if (in < 0 || score(i) < score(in))
+                        in = i;
+                } else if (candidates.testBit(i) && !swapTried.testBit(i)) {
+                    if (out < 0 || score(i) > score(out))
+                        out = i;
+                }
+            }
+
+            if (in < 0 || out < 0 || score(out) <= score(in))
+                break;
+            swapTried.setBit(out);
+            bits = best;
+            bits.clearBit(in);
+            bits.setBit(out);
+            bits = makeValid(bits);
+            if (totalScore(bits) <= bestScore)
+                break;
+            continue;
+        }
+
+        // Some layers are rejected by the backend, try again without them
+        const QBitArray next = makeValid(accepted);
+        if (next == bits)
+            break;
+        bits = next;
+    }
+
+    for (int i = 0; i < count; ++i)
+        layers[i].accepted = best.testBit(i);
+
+    m_planeAssignment.layers = key;
+    m_planeAssignment.hardware = best;
+    m_planeAssignment.disableHardwareLayers = disableHardwareLayers();
+    m_planeAssignment.scanout = scanout;
+    // Don't keep the result if the output can't pass the test, maybe it's
+    // caused by the primary buffer
+    m_planeAssignment.valid = tested;
+
+    return best;
 }
 
 #define PRIVATE_WOutputViewport "__private_WOutputViewport"
@@ -1038,6 +1795,7 @@ WBufferRenderer *OutputHelper::compositeLayers(const QList<LayerData*> layers, b
     } else {
         if (bufferRenderer()->currentBuffer()) {
             render(bufferRenderer(), 1, {}, m_output->effectiveSourceRect(), m_output->targetRect(), true);
+            m_layersInPrimaryBuffer = true;
         } else {
             // ###(zccrs): Maybe because contents is not dirty, so not do render
             // in WOutputRenderWindowPrivate::doRenderOutputs, force mark the
@@ -1051,12 +1809,52 @@ WBufferRenderer *OutputHelper::compositeLayers(const QList<LayerData*> layers, b
 
 bool OutputHelper::commit(WBufferRenderer *buffer)
 {
-    if (output()->offscreen())
+    if (output()->offscreen()) {
+        if (buffer && buffer->currentBuffer())
+            captureFrame(buffer, buffer->currentBuffer());
         return true;
+    }
+
+    if (m_scanoutBuffer) {
+        Q_ASSERT(!buffer || !buffer->currentBuffer());
+        const QPointer<qw_buffer> scanoutBuffer = std::exchange(m_scanoutBuffer, nullptr);
+        setBuffer(scanoutBuffer);
+        // The damage of the WBufferRenderer isn't relative to the client buffer,
+        // the next commit of the WBufferRenderer's buffer needs full damage.
+        m_lastCommitBuffer = nullptr;
+        if (!doCommit())
+            return false;
+        captureFrame(nullptr, scanoutBuffer);
+        return true;
+    }
 
     if (!buffer || !buffer->currentBuffer()) {
         Q_ASSERT(!this->buffer());
-        return WOutputHelper::commit();
+        // The render of the scene is skipped in the cursor-only frame, but the
+        // layers needn't composite now(e.g. the cursor is moved to the cursor
+        // plane), the output is still showing the composited buffer.
+        if (buffer && m_lastCommitBuffer && m_lastCommitBuffer != buffer
+            && buffer->lastBuffer() && !m_layersInPrimaryBuffer) {
+            setBuffer(buffer->lastBuffer());
+            m_lastCommitBuffer = buffer;
+        }
+        if (!doCommit())
+            return false;
+        if (m_lastCommitBuffer)
+            captureFrame(m_lastCommitBuffer, m_lastCommitBuffer->lastBuffer());
+        return true;
+    }
+
+    // The scene is changed but not on this output, don't commit the same
+    // contents again, the output can keep idle. But the other pending state
+    // (e.g. the scale or the gamma LUT) must be committed.
+    if (m_lastCommitBuffer == buffer
+        && m_layers.isEmpty()
+        && !needsFrame()
+        && !hasPendingState()
+        && !pixman_region32_not_empty(&buffer->damageRing()->handle()->current)) {
+        captureFrame(buffer, buffer->currentBuffer());
+        return true;
     }
 
     setBuffer(buffer->currentBuffer());
@@ -1067,17 +1865,55 @@ bool OutputHelper::commit(WBufferRenderer *buffer)
     }
 
     m_lastCommitBuffer = buffer;
+    if (!doCommit())
+        return false;
+    // Only the frames shown on the output are captured
+    captureFrame(buffer, buffer->currentBuffer());
 
-    return WOutputHelper::commit();
+    return true;
+}
+
+// Send the buffer shown on the output to the WFrameCapturers of the viewport,
+// the damage is known only if the buffer is rendered by the same renderer as
+// the last captured frame, e.g. not after the direct scanout.
+void OutputHelper::captureFrame(WBufferRenderer *renderer, qw_buffer *buffer)
+{
+    const auto &capturers = WOutputViewportPrivate::get(output())->frameCapturers;
+    if (capturers.isEmpty() || !buffer) {
+        m_lastCaptureRenderer = nullptr;
+        return;
+    }
+
+    const pixman_region32_t *damage = nullptr;
+    if (renderer && renderer == m_lastCaptureRenderer)
+        damage = &renderer->damageRing()->handle()->current;
+    m_lastCaptureRenderer = renderer;
+
+    for (WFrameCapturer *capturer : std::as_const(capturers))
+        WFrameCapturerPrivate::get(capturer)->onFrame(buffer, damage);
+}
+
+bool OutputHelper::doCommit()
+{
+    if (!WOutputHelper::commit()) {
+        // The planes maybe can't be used, test them again in the next frame
+        m_planeAssignment.valid = false;
+        // The frame isn't captured, the damage of the next frame isn't
+        // relative to the last captured frame.
+        m_lastCaptureRenderer = nullptr;
+        return false;
+    }
+
+    markFrameCommitted(renderWindowD()->renderStartTime);
+    return true;
 }
 
 bool OutputHelper::tryToHardwareCursor(const LayerData *layer)
 {
     do {
         auto set_cursor = qwoutput()->handle()->impl->set_cursor;
-        auto buffer = layer && layer->renderer->lastBuffer()
-                          ? layer->renderer->lastBuffer()->handle()
-                          : nullptr;
+        qw_buffer *qwbuffer = layer ? layer->renderer->lastBuffer() : nullptr;
+        auto buffer = qwbuffer ? qwbuffer->handle() : nullptr;
         if (!buffer) {
             if (!m_hardwareCursorRenderComplete)
                 return true;
@@ -1085,6 +1921,7 @@ bool OutputHelper::tryToHardwareCursor(const LayerData *layer)
             if (set_cursor)
                 set_cursor(qwoutput()->handle(), buffer, 0, 0);
             m_hardwareCursorRenderComplete = false;
+            m_hardwareCursorBuffer = nullptr;
             return true;
         }
 
@@ -1167,18 +2004,32 @@ bool OutputHelper::tryToHardwareCursor(const LayerData *layer)
                 Q_ASSERT(pixelSize.width() == newBuffer->handle()->width);
                 Q_ASSERT(pixelSize.height() == newBuffer->handle()->height);
                 buffer = newBuffer->handle();
+                qwbuffer = newBuffer;
             } else {
                 buffer = nullptr;
+                qwbuffer = nullptr;
             }
         }
 
         const auto hotSpot = layer->renderMatrix.map(layer->layer->layer->cursorHotSpot()
                                                      * devicePixelRatio()).toPoint();
-        if (!set_cursor(qwoutput()->handle(), buffer, hotSpot.x(), hotSpot.y())) {
-            break;
-        } else {
-            m_hardwareCursorRenderComplete = true;
+        // The cursor plane keeps the last buffer, only move the cursor if
+        // the contents isn't changed, it's the common case when the pointer
+        // is moving, avoid set_cursor and the reset of the GL state.
+        if (!m_hardwareCursorRenderComplete || !qwbuffer
+            || m_hardwareCursorBuffer != qwbuffer || m_hardwareCursorHotSpot != hotSpot) {
+            // wlroots maybe blit the buffer for the cursor plane by its renderer
+            // in set_cursor, so needs to reset the GL state even if failed.
+            const bool ok = set_cursor(qwoutput()->handle(), buffer, hotSpot.x(), hotSpot.y());
             resetGlState();
+            if (!ok) {
+                m_hardwareCursorBuffer = nullptr;
+                return false;
+            }
+
+            m_hardwareCursorRenderComplete = true;
+            m_hardwareCursorBuffer = qwbuffer;
+            m_hardwareCursorHotSpot = hotSpot;
         }
 
         const auto pos = layer->mapToOutput.topLeft() + hotSpot;
@@ -1191,12 +2042,14 @@ bool OutputHelper::tryToHardwareCursor(const LayerData *layer)
                           qwoutput()->handle()->transform,
                           outputSize.width(), outputSize.height());
         if (!move_cursor(qwoutput()->handle(), cleanTransform.x, cleanTransform.y)) {
-            break;
+            m_hardwareCursorBuffer = nullptr;
+            return false;
         }
 
         return true;
     } while (false);
 
+    m_hardwareCursorBuffer = nullptr;
     resetGlState();
 
     return false;
@@ -1261,12 +2114,15 @@ void WOutputRenderWindowPrivate::init()
     6. QQuickRenderControlPrivate::maybeUpdate
     7. QQuickRenderControl::sceneChanged
     */
+    animationDriver = new FrameClockAnimationDriver(q);
+    animationDriver->install();
+
     // TODO: Get damage regions from the Qt, and use WOutputDamage::add instead of WOutput::update.
     QObject::connect(rc(), &QQuickRenderControl::renderRequested,
                      q, qOverload<>(&WOutputRenderWindow::update));
     QObject::connect(rc(), &QQuickRenderControl::sceneChanged,
                      q, [q, this] {
-        if (inRendering)
+        if (inRendering || advancingAnimations)
             return;
         q->update();
     });
@@ -1350,6 +2206,15 @@ bool WOutputRenderWindowPrivate::initRCWithRhi()
         return false;
     }
 
+#if QT_VERSION >= QT_VERSION_CHECK(6, 6, 0)
+    // For the GPU time of the frame trace
+    if (!frameTraceFileName().isEmpty()) {
+        auto config = q->graphicsConfiguration();
+        config.setTimestamps(true);
+        q->setGraphicsConfiguration(config);
+    }
+#endif
+
     QOffscreenSurface *offscreenSurface = new QW::OffscreenSurface(nullptr, q);
     offscreenSurface->create();
 
@@ -1405,6 +2270,8 @@ WOutputRenderWindowPrivate::doRenderOutputs(const QList<OutputHelper*> &outputs,
     QVector<OutputHelper*> renderResults;
     renderResults.reserve(outputs.size());
     for (OutputHelper *helper : std::as_const(outputs)) {
+        helper->stageTimes().reset();
+
         if (Q_LIKELY(!forceRender)) {
             if (!helper->renderable()
                 || Q_UNLIKELY(!WOutputViewportPrivate::get(helper->output())->renderable())
@@ -1420,29 +2287,20 @@ WOutputRenderWindowPrivate::doRenderOutputs(const QList<OutputHelper*> &outputs,
 
         Q_ASSERT(helper->output()->output()->scale() <= helper->output()->devicePixelRatio());
 
-        const auto &format = helper->qwoutput()->handle()->render_format;
-        const auto renderMatrix = helper->output()->renderMatrix();
-
-        // maybe using the other WOutputViewport's QSGTextureProvider
-        if (!helper->output()->depends().isEmpty())
-            updateDirtyNodes();
-
-        qw_buffer *buffer = helper->beginRender(helper->bufferRenderer(), helper->output()->output()->size(), format,
-                                                WBufferRenderer::RedirectOpenGLContextDefaultFrameBufferObject);
-        Q_ASSERT(buffer == helper->bufferRenderer()->currentBuffer());
-        if (buffer) {
-            helper->render(helper->bufferRenderer(), 0, renderMatrix,
-                           helper->output()->effectiveSourceRect(),
-                           helper->output()->targetRect(),
-                           helper->output()->preserveColorContents());
-        }
+        // The forced render wants the contents of the WBufferRenderer
+        const qint64 renderBegin = monotonicTime();
+        if (forceRender || (!helper->canSkipRenderOutput() && !helper->tryToDirectScanout()))
+            helper->renderOutput();
+        helper->stageTimes().add(RenderStage, renderBegin);
         renderResults.append(helper);
     }
 
     QVector<std::pair<OutputHelper*, WBufferRenderer*>> needsCommit;
     needsCommit.reserve(renderResults.size());
     for (auto helper : std::as_const(renderResults)) {
+        const qint64 afterRenderBegin = monotonicTime();
         auto bufferRenderer = helper->afterRender();
+        helper->stageTimes().add(AfterRenderStage, afterRenderBegin);
         if (bufferRenderer)
             needsCommit.append({helper, bufferRenderer});
     }
@@ -1452,22 +2310,333 @@ WOutputRenderWindowPrivate::doRenderOutputs(const QList<OutputHelper*> &outputs,
     return needsCommit;
 }
 
+void WOutputRenderWindowPrivate::beginFrame()
+{
+    if (QSGRendererInterface::isApiRhiBased(WRenderHelper::getGraphicsApi()))
+        rc()->beginFrame();
+}
+
+void WOutputRenderWindowPrivate::endFrame()
+{
+    if (QSGRendererInterface::isApiRhiBased(WRenderHelper::getGraphicsApi())) {
+#if QT_VERSION >= QT_VERSION_CHECK(6, 6, 0)
+        auto cb = rc()->commandBuffer();
+#endif
+        rc()->endFrame();
+        WBufferRenderer::resetRhiWorks(rhi);
+
+#if QT_VERSION >= QT_VERSION_CHECK(6, 6, 0)
+        // The offscreen frame is completed in QRhi::endOffscreenFrame, the
+        // time is 0 if the timestamps are not enabled.
+        const double gpuTime = cb ? cb->lastCompletedGpuTime() : 0;
+        gpuDuration = gpuTime > 0 ? qint64(gpuTime * 1e9) : -1;
+#endif
+    }
+}
+
+void WOutputRenderWindowPrivate::commitOutputs(const QVector<std::pair<OutputHelper*, WBufferRenderer*>> &outputs)
+{
+    for (auto i : outputs) {
+        const qint64 commitBegin = monotonicTime();
+        bool ok = i.first->commit(i.second);
+        i.first->stageTimes().add(CommitStage, commitBegin);
+
+        if (i.second->currentBuffer()) {
+            i.second->endRender();
+        }
+
+        i.first->resetState(ok);
+        recordFrameTiming(i.first);
+    }
+}
+
+void WOutputRenderWindowPrivate::recordFrameTiming(OutputHelper *helper)
+{
+    if (frameTimingCapacity <= 0 && frameTraceFileName().isEmpty())
+        return;
+
+    const auto &outputTimes = helper->stageTimes();
+    WOutputRenderWindow::FrameTiming timing;
+    timing.frame = frameNumber;
+    timing.output = helper->output()->output()->name();
+    timing.startTime = renderStartTime;
+    timing.polishDuration = stageTimes.duration[PolishStage];
+    timing.syncDuration = stageTimes.duration[SyncStage];
+    timing.animatorDuration = stageTimes.duration[AnimatorStage];
+    timing.renderDuration = outputTimes.duration[RenderStage];
+    timing.afterRenderDuration = outputTimes.duration[AfterRenderStage];
+    timing.compositeDuration = outputTimes.duration[CompositeStage];
+    timing.commitDuration = outputTimes.duration[CommitStage];
+    timing.gpuDuration = gpuDuration;
+
+    if (frameTimingCapacity > 0) {
+        if (frameTimings.size() < frameTimingCapacity) {
+            frameTimings.append(timing);
+        } else {
+            frameTimings[frameTimingNext] = timing;
+            frameTimingNext = (frameTimingNext + 1) % frameTimingCapacity;
+        }
+    }
+
+    if (!frameTraceFileName().isEmpty())
+        writeFrameTrace(timing, outputTimes);
+}
+
+// Write the stages as the complete events of the Chrome trace event format,
+// the file can be opened by chrome://tracing and https://ui.perfetto.dev. The
+// closing bracket of the JSON array is optional for this format.
+void WOutputRenderWindowPrivate::writeFrameTrace(const WOutputRenderWindow::FrameTiming &timing,
+                                                 const FrameStageTimes &outputStageTimes)
+{
+    if (!frameTraceFile) {
+        frameTraceFile.reset(new QFile(frameTraceFileName()));
+        if (!frameTraceFile->open(QIODevice::WriteOnly | QIODevice::Truncate | QIODevice::Text)) {
+            qCWarning(wlcRenderer) << "Can't open the frame trace file" << frameTraceFile->fileName()
+                                   << frameTraceFile->errorString();
+        } else {
+            frameTraceFile->write("[\n");
+        }
+    }
+
+    if (!frameTraceFile->isOpen())
+        return;
+
+    const qint64 pid = QCoreApplication::applicationPid();
+    auto writeEvent = [&] (const char *name, qint64 begin, qint64 duration, const QString &thread) {
+        if (!begin)
+            return;
+        frameTraceFile->write(QStringLiteral("{\"name\":\"%1\",\"cat\":\"waylib\",\"ph\":\"X\","
+                                             "\"ts\":%2,\"dur\":%3,\"pid\":%4,\"tid\":\"%5\","
+                                             "\"args\":{\"frame\":%6}},\n")
+                                  .arg(QLatin1StringView(name))
+                                  .arg(begin / 1000.0, 0, 'f', 3)
+                                  .arg(duration / 1000.0, 0, 'f', 3)
+                                  .arg(pid)
+                                  .arg(thread)
+                                  .arg(timing.frame).toUtf8());
+    };
+
+    // The stages of the window are written once for a frame
+    if (stageTimes.begin[PolishStage]) {
+        for (int i = PolishStage; i <= AnimatorStage; ++i) {
+            const auto stage = static_cast<FrameStage>(i);
+            writeEvent(frameStageName(stage), stageTimes.begin[i], stageTimes.duration[i],
+                       QStringLiteral("window"));
+        }
+        if (timing.gpuDuration >= 0) {
+            writeEvent("gpu", stageTimes.begin[PolishStage], timing.gpuDuration,
+                       QStringLiteral("gpu"));
+        }
+        stageTimes.begin[PolishStage] = 0;
+    }
+
+    for (int i = RenderStage; i < FrameStageCount; ++i) {
+        const auto stage = static_cast<FrameStage>(i);
+        writeEvent(frameStageName(stage), outputStageTimes.begin[i], outputStageTimes.duration[i],
+                   timing.output);
+    }
+
+    frameTraceFile->flush();
+}
+
 // ###: QQuickAnimatorController::advance symbol not export
+// Unlike QQuickAnimatorController::advance, don't request an update of the
+// window, only the outputs showing the animators are updated, see
+// WOutputRenderWindowPrivate::updateAnimatedOutputs.
 static void QQuickAnimatorController_advance(QQuickAnimatorController *ac)
 {
-    bool running = false;
-    for (const QSharedPointer<QAbstractAnimationJob> &job : std::as_const(ac->m_animationRoots)) {
-        if (job->isRunning()) {
-            running = true;
+    for (QQuickAnimatorJob *job : std::as_const(ac->m_runningAnimators))
+        job->commit();
+}
+
+// Returns false if there are too many items to visit in the tree of the item
+static bool itemTreeSceneRect(QQuickItem *item, QRectF *rect, int *budget)
+{
+    if (--*budget < 0)
+        return false;
+
+    auto d = QQuickItemPrivate::get(item);
+    *rect |= d->itemToWindowTransform().mapRect(item->boundingRect());
+    if (item->clip())
+        return true;
+
+    for (QQuickItem *child : std::as_const(d->childItems)) {
+        if (child->isVisible() && !itemTreeSceneRect(child, rect, budget))
+            return false;
+    }
+
+    return true;
+}
+
+// The item is used by ShaderEffectSource or the layer of the item, it may be
+// shown anywhere
+static bool isUsedByEffectItem(QQuickItem *item)
+{
+    for (; item; item = item->parentItem()) {
+        auto d = QQuickItemPrivate::get(item);
+        if (d->extra.isAllocated() && d->extra->effectRefCount > 0)
+            return true;
+    }
+
+    return false;
+}
+
+bool WOutputRenderWindowPrivate::animatorIsRunning() const
+{
+    if (!animationController->m_runningAnimators.isEmpty())
+        return true;
+    for (const QSharedPointer<QAbstractAnimationJob> &job : std::as_const(animationController->m_animationRoots)) {
+        if (job->isRunning())
+            return true;
+    }
+
+    return false;
+}
+
+// Advance the animations to the time the frame will be presented instead of
+// the time it's rendered, the property changes of the animations are synced
+// in this frame.
+void WOutputRenderWindowPrivate::advanceAnimations(const QList<OutputHelper *> &outputs)
+{
+    animationsAdvanced = false;
+    if (!animationDriver || !animationDriver->isRunning())
+        return;
+
+    const qint64 now = monotonicTime();
+    qint64 presentTime = now;
+    for (OutputHelper *helper : outputs)
+        presentTime = qMax(presentTime, helper->predictPresentTime(now));
+
+    animationDriver->advanceTo(presentTime);
+    animationsAdvanced = true;
+}
+
+// Called by the fallback timer of the animation driver if no output is
+// rendering. Like in rendering, the changes of the animations don't update the
+// whole window, only the outputs showing the animated items are updated.
+void WOutputRenderWindowPrivate::advanceAnimationsOutOfRendering(qint64 time)
+{
+    Q_ASSERT(!inRendering);
+    advancingAnimations = true;
+    animationDriver->advanceTo(time);
+    advancingAnimations = false;
+
+    collectAnimatedItems();
+    updateAnimatedOutputs();
+}
+
+void FrameClockAnimationDriver::advanceOutOfRendering(qint64 time)
+{
+    WOutputRenderWindowPrivate::get(m_window)->advanceAnimationsOutOfRendering(time);
+}
+
+// The sceneChanged of QQuickRenderControl is ignored in rendering, record the
+// items changed by the animations and the layout caused by them, the outputs
+// will be updated in updateAnimatedOutputs.
+void WOutputRenderWindowPrivate::collectAnimatedItems()
+{
+    for (QQuickItem *item = dirtyItemList; item; item = QQuickItemPrivate::get(item)->nextDirtyItem)
+        animatedItems.append(item);
+}
+
+// Schedule a frame only for the outputs whose viewport contains the animated
+// items, the animations on one output don't keep the other outputs rendering.
+// Be conservative if the area of an item is unknown, e.g. the first frame of
+// an animation, the old area of the item isn't recorded.
+void WOutputRenderWindowPrivate::updateAnimatedOutputs()
+{
+    for (QQuickAnimatorJob *job : std::as_const(animationController->m_runningAnimators)) {
+        if (job->target())
+            animatedItems.append(job->target());
+    }
+
+    if (animatedItems.isEmpty()) {
+        animatedItemRects.clear();
+        return;
+    }
+
+    constexpr int maxItemsOfTree = 256;
+    bool updateAll = false;
+    QHash<QQuickItem*, QRectF> newRects;
+    newRects.reserve(animatedItems.size());
+    QList<std::pair<QQuickItem*, QRectF>> areas;
+    areas.reserve(animatedItems.size());
+
+    for (QQuickItem *item : std::as_const(animatedItems)) {
+        if (newRects.contains(item))
+            continue;
+
+        QRectF rect;
+        int budget = maxItemsOfTree;
+        if (!itemTreeSceneRect(item, &rect, &budget) || isUsedByEffectItem(item)) {
+            updateAll = true;
             break;
         }
+        newRects.insert(item, rect);
+
+        auto oldRect = animatedItemRects.constFind(item);
+        if (oldRect == animatedItemRects.constEnd()) {
+            updateAll = true;
+            continue;
+        }
+        areas.append({item, rect | *oldRect});
     }
 
-    for (QQuickAnimatorJob *job : std::as_const(ac->m_runningAnimators))
-        job->commit();
+    animatedItems.clear();
+    // Only keep the items still animating, the others will be unknown again
+    animatedItemRects = std::move(newRects);
+
+    for (OutputHelper *helper : std::as_const(outputs)) {
+        WOutputViewport *viewport = helper->output();
+        bool showsAnimation = updateAll;
+
+        if (!showsAnimation) {
+            const QRectF viewportRect = viewport->effectiveSourceRect();
+            const QMatrix4x4 matrix = viewport->mapToViewport(contentItem);
+            QQuickItem *input = viewport->input();
+
+            for (const auto &area : std::as_const(areas)) {
+                // The item isn't a child of the input, e.g. the input is a
+                // texture provider, the viewport doesn't map its position
+                if (viewportRect.isEmpty()
+                    || (input && input != area.first && !input->isAncestorOf(area.first))
+                    || matrix.mapRect(area.second).intersects(viewportRect)) {
+                    showsAnimation = true;
+                    break;
+                }
+            }
+        }
+
+        if (showsAnimation)
+            helper->update();
+    }
+}
+
+// Returns true if nothing is changed but the positions of the cursor layers.
+// The cursor layers are rendered to their own buffers and hidden in the scene
+// of the outputs, so the frame can skip the polish, the sync and the render of
+// the outputs' scene. Only the cursor layers are moved, in the cursor plane or
+// composited on the last buffer of the scene, see OutputHelper::canSkipRenderOutput.
+bool WOutputRenderWindowPrivate::isCursorOnlyFrame() const
+{
+    static bool disabled = qEnvironmentVariableIsSet("WAYLIB_NO_CURSOR_ONLY_FRAMES");
+    if (disabled || !dirtyItemList || !itemsToPolish.isEmpty() || animatorIsRunning())
+        return false;
+
+    for (QQuickItem *item = dirtyItemList; item; item = QQuickItemPrivate::get(item)->nextDirtyItem) {
+        if (QQuickItemPrivate::get(item)->dirtyAttributes != QQuickItemPrivate::Position)
+            return false;
+
+        const bool isCursorLayer = std::any_of(layers.cbegin(), layers.cend(),
+                                               [item] (const OutputLayer *layer) {
+            return layer->layer->parent() == item && layer->isEnabled()
+                   && layer->layer->flags().testFlag(WOutputLayer::Cursor);
+        });
+        if (!isCursorLayer)
+            return false;
+    }
 
-    if (running)
-        ac->m_window->update();
+    return true;
 }
 
 void WOutputRenderWindowPrivate::doRender(const QList<OutputHelper *> &outputs,
@@ -1476,41 +2645,62 @@ void WOutputRenderWindowPrivate::doRender(const QList<OutputHelper *> &outputs,
     Q_ASSERT(rendererList.isEmpty());
     Q_ASSERT(!inRendering);
     inRendering = true;
+    renderStartTime = monotonicTime();
+    ++frameNumber;
+    stageTimes.reset();
 
     W_Q(WOutputRenderWindow);
     for (OutputLayer *layer : std::as_const(layers)) {
         layer->beforeRender(q);
     }
 
-    rc()->polishItems();
+    qint64 animationBegin = monotonicTime();
+    advanceAnimations(outputs);
+    stageTimes.add(AnimatorStage, animationBegin);
 
-    if (QSGRendererInterface::isApiRhiBased(WRenderHelper::getGraphicsApi()))
-        rc()->beginFrame();
-    rc()->sync();
+    cursorOnlyFrame = !forceRender && isCursorOnlyFrame();
+    if (cursorOnlyFrame) {
+        lastCursorOnlyFrame = frameNumber;
 
-    QQuickAnimatorController_advance(animationController.get());
+        beginFrame();
+        // Only the cursor items are dirty, there is nothing to polish and animate
+        const qint64 stageBegin = monotonicTime();
+        updateDirtyNodes();
+        stageTimes.add(SyncStage, stageBegin);
+    } else {
+        qint64 stageBegin = monotonicTime();
+        rc()->polishItems();
+        stageTimes.add(PolishStage, stageBegin);
+
+        beginFrame();
+        if (animationsAdvanced)
+            collectAnimatedItems();
+        stageBegin = monotonicTime();
+        rc()->sync();
+        stageTimes.add(SyncStage, stageBegin);
+
+        stageBegin = monotonicTime();
+        QQuickAnimatorController_advance(animationController.get());
+        if (animationsAdvanced || animatorIsRunning()) {
+            // The animators write back to the items after the sync
+            collectAnimatedItems();
+            updateAnimatedOutputs();
+        }
+        stageTimes.add(AnimatorStage, stageBegin);
+    }
     Q_EMIT q->beforeRendering();
     runAndClearJobs(&beforeRenderingJobs);
 
-    auto needsCommit = doRenderOutputs(outputs, forceRender);
+    const auto needsCommit = doRenderOutputs(outputs, forceRender);
 
     Q_EMIT q->afterRendering();
     runAndClearJobs(&afterRenderingJobs);
 
-    if (QSGRendererInterface::isApiRhiBased(WRenderHelper::getGraphicsApi()))
-        rc()->endFrame();
-
-    if (doCommit) {
-        for (auto i : std::as_const(needsCommit)) {
-            bool ok = i.first->commit(i.second);
-
-            if (i.second->currentBuffer()) {
-                i.second->endRender();
-            }
-
-            i.first->resetState(ok);
-        }
-    }
+    endFrame();
+    if (doCommit)
+        commitOutputs(needsCommit);
+    // The buffers are committed, the work here doesn't delay the page flip
+    Q_EMIT q->outputsCommitted();
 
     resetGlState();
 
@@ -1522,6 +2712,7 @@ void WOutputRenderWindowPrivate::doRender(const QList<OutputHelper *> &outputs,
     if (glContext)
         glContext->doneCurrent();
 
+    cursorOnlyFrame = false;
     inRendering = false;
     Q_EMIT q->renderEnd();
 }
@@ -1549,7 +2740,12 @@ WOutputRenderWindow::WOutputRenderWindow(QObject *parent)
 
 WOutputRenderWindow::~WOutputRenderWindow()
 {
+    Q_D(WOutputRenderWindow);
     qGuiApp->removeEventFilter(this);
+    if (d->animationDriver)
+        d->animationDriver->uninstall();
+    // Must release the QRhiTextures before the QRhi is destroyed
+    d->textureCache.reset();
 
     renderControl()->disconnect(this);
     renderControl()->invalidate();
@@ -1653,6 +2849,7 @@ void WOutputRenderWindow::attach(WOutputLayer *layer, WOutputViewport *output)
         d->scheduleDoRender();
 
     connect(layer, &WOutputLayer::flagsChanged, this, &WOutputRenderWindow::scheduleRender);
+    connect(layer, &WOutputLayer::formatsChanged, this, &WOutputRenderWindow::scheduleRender);
     connect(layer, &WOutputLayer::zChanged, this, &WOutputRenderWindow::scheduleRender);
 
     if (auto od = WOutputViewportPrivate::get(output)) {
@@ -1743,6 +2940,14 @@ QList<WOutputLayer *> WOutputRenderWindow::hardwareLayers(const WOutputViewport
     return list;
 }
 
+WSGTextureCache *WOutputRenderWindow::textureCache() const
+{
+    Q_D(const WOutputRenderWindow);
+    if (!d->textureCache)
+        const_cast<WOutputRenderWindowPrivate*>(d)->textureCache.reset(new WSGTextureCache());
+    return d->textureCache.get();
+}
+
 void WOutputRenderWindow::setOutputScale(WOutputViewport *output, float scale)
 {
     Q_D(WOutputRenderWindow);
@@ -1810,6 +3015,62 @@ bool WOutputRenderWindow::inRendering() const
     return d->inRendering;
 }
 
+WOutputRenderWindow::FrameStatistics WOutputRenderWindow::frameStatistics(const WOutputViewport *output) const
+{
+    Q_D(const WOutputRenderWindow);
+    auto helper = d->getOutputHelper(output);
+    if (!helper)
+        return {};
+
+    auto statistics = helper->frameStatistics();
+    statistics.nextPresentTime = helper->predictPresentTime(monotonicTime());
+    return statistics;
+}
+
+WOutputRenderWindow::TextureCacheStatistics WOutputRenderWindow::textureCacheStatistics() const
+{
+    Q_D(const WOutputRenderWindow);
+    if (!d->textureCache)
+        return {};
+
+    const auto statistics = d->textureCache->statistics();
+    return {statistics.hits, statistics.misses, statistics.size};
+}
+
+QList<WOutputRenderWindow::FrameTiming> WOutputRenderWindow::frameTimings() const
+{
+    Q_D(const WOutputRenderWindow);
+    if (d->frameTimingNext == 0)
+        return d->frameTimings;
+
+    return d->frameTimings.mid(d->frameTimingNext) + d->frameTimings.mid(0, d->frameTimingNext);
+}
+
+QVariantList WOutputRenderWindow::frameTimingList() const
+{
+    QVariantList list;
+    const auto timings = frameTimings();
+    list.reserve(timings.size());
+
+    for (const auto &t : timings) {
+        list.append(QVariantMap {
+            {"frame", t.frame},
+            {"output", t.output},
+            {"startTime", t.startTime},
+            {"polishDuration", t.polishDuration},
+            {"syncDuration", t.syncDuration},
+            {"animatorDuration", t.animatorDuration},
+            {"renderDuration", t.renderDuration},
+            {"afterRenderDuration", t.afterRenderDuration},
+            {"compositeDuration", t.compositeDuration},
+            {"commitDuration", t.commitDuration},
+            {"gpuDuration", t.gpuDuration},
+        });
+    }
+
+    return list;
+}
+
 QList<QPointer<QQuickItem>> WOutputRenderWindow::paintOrderItemList(QQuickItem *root, std::function<bool(QQuickItem*)> filter)
 {
     QStack<QQuickItem *> nodes;
@@ -1846,6 +3107,58 @@ void WOutputRenderWindow::setDisableLayers(bool newDisableLayers)
     Q_EMIT disableLayersChanged();
 }
 
+bool WOutputRenderWindow::lateLatching() const
+{
+    Q_D(const WOutputRenderWindow);
+    return d->lateLatching;
+}
+
+void WOutputRenderWindow::setLateLatching(bool newLateLatching)
+{
+    Q_D(WOutputRenderWindow);
+    if (d->lateLatching == newLateLatching)
+        return;
+    d->lateLatching = newLateLatching;
+    Q_EMIT lateLatchingChanged();
+}
+
+int WOutputRenderWindow::renderSafetyMargin() const
+{
+    Q_D(const WOutputRenderWindow);
+    return d->renderSafetyMargin;
+}
+
+void WOutputRenderWindow::setRenderSafetyMargin(int newRenderSafetyMargin)
+{
+    Q_D(WOutputRenderWindow);
+    if (d->renderSafetyMargin == newRenderSafetyMargin)
+        return;
+    d->renderSafetyMargin = newRenderSafetyMargin;
+    Q_EMIT renderSafetyMarginChanged();
+}
+
+int WOutputRenderWindow::frameTimingCapacity() const
+{
+    Q_D(const WOutputRenderWindow);
+    return d->frameTimingCapacity;
+}
+
+void WOutputRenderWindow::setFrameTimingCapacity(int newFrameTimingCapacity)
+{
+    Q_D(WOutputRenderWindow);
+    newFrameTimingCapacity = qMax(0, newFrameTimingCapacity);
+    if (d->frameTimingCapacity == newFrameTimingCapacity)
+        return;
+    // Keep the newest timings
+    auto timings = frameTimings();
+    if (timings.size() > newFrameTimingCapacity)
+        timings.remove(0, timings.size() - newFrameTimingCapacity);
+    d->frameTimings = timings;
+    d->frameTimingNext = 0;
+    d->frameTimingCapacity = newFrameTimingCapacity;
+    Q_EMIT frameTimingCapacityChanged();
+}
+
 void WOutputRenderWindow::render()
 {
     Q_D(WOutputRenderWindow);
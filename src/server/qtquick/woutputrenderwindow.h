@@ -17,6 +17,7 @@ WAYLIB_SERVER_BEGIN_NAMESPACE
 class WOutputViewport;
 class WOutputLayer;
 class WBufferRenderer;
+class WSGTextureCache;
 class WOutputRenderWindowPrivate;
 class WAYLIB_SERVER_EXPORT WOutputRenderWindow : public QQuickWindow, public QQmlParserStatus
 {
@@ -25,10 +26,57 @@ class WAYLIB_SERVER_EXPORT WOutputRenderWindow : public QQuickWindow, public QQm
     Q_PROPERTY(qreal width READ width WRITE setWidth NOTIFY widthChanged)
     Q_PROPERTY(qreal height READ height WRITE setHeight NOTIFY heightChanged)
     Q_PROPERTY(bool disableLayers READ disableLayers WRITE setDisableLayers NOTIFY disableLayersChanged FINAL)
+    Q_PROPERTY(bool lateLatching READ lateLatching WRITE setLateLatching NOTIFY lateLatchingChanged FINAL)
+    Q_PROPERTY(int renderSafetyMargin READ renderSafetyMargin WRITE setRenderSafetyMargin NOTIFY renderSafetyMarginChanged FINAL)
+    Q_PROPERTY(int frameTimingCapacity READ frameTimingCapacity WRITE setFrameTimingCapacity NOTIFY frameTimingCapacityChanged FINAL)
     QML_NAMED_ELEMENT(OutputRenderWindow)
     Q_INTERFACES(QQmlParserStatus)
 
 public:
+    // The times are in nanoseconds of the CLOCK_MONOTONIC
+    struct FrameStatistics {
+        qint64 refreshInterval = 0;
+        qint64 lastPresentTime = 0;
+        // The predicted time of the next vblank, it's 0 if unknown
+        qint64 nextPresentTime = 0;
+        // From the beginning of the render to the commit is done
+        qint64 lastRenderDuration = 0;
+        qint64 averageRenderDuration = 0;
+        quint64 committedFrames = 0;
+        quint64 presentedFrames = 0;
+        // The frames presented later than the vblank predicted at the commit
+        quint64 missedFrames = 0;
+    };
+
+    // The time spent in the stages of a frame of an output, the durations
+    // are in nanoseconds, the polish, sync and animator stages are shared
+    // by all outputs rendered in the same frame.
+    struct FrameTiming {
+        quint64 frame = 0;
+        QString output;
+        // CLOCK_MONOTONIC
+        qint64 startTime = 0;
+        qint64 polishDuration = 0;
+        qint64 syncDuration = 0;
+        qint64 animatorDuration = 0;
+        // Render the sources of the output
+        qint64 renderDuration = 0;
+        // Render the layers and composite them, including the compositeDuration
+        qint64 afterRenderDuration = 0;
+        qint64 compositeDuration = 0;
+        qint64 commitDuration = 0;
+        // The GPU time of the frame, it's -1 if the RHI doesn't support the
+        // timestamp queries or they are not enabled
+        qint64 gpuDuration = -1;
+    };
+
+    // The cache of the textures made from the clients' dmabufs
+    struct TextureCacheStatistics {
+        quint64 hits = 0;
+        quint64 misses = 0;
+        int size = 0;
+    };
+
     explicit WOutputRenderWindow(QObject *parent = nullptr);
     ~WOutputRenderWindow();
 
@@ -54,12 +102,27 @@ public:
     qreal height() const;
     WBufferRenderer *currentRenderer() const;
     bool inRendering() const;
+    FrameStatistics frameStatistics(const WOutputViewport *output) const;
+    TextureCacheStatistics textureCacheStatistics() const;
+    // The timings of the last frameTimingCapacity frames, from oldest to newest
+    QList<FrameTiming> frameTimings() const;
+    Q_INVOKABLE QVariantList frameTimingList() const;
 
     static QList<QPointer<QQuickItem>> paintOrderItemList(QQuickItem *root, std::function<bool(QQuickItem*)> filter);
 
     bool disableLayers() const;
     void setDisableLayers(bool newDisableLayers);
 
+    bool lateLatching() const;
+    void setLateLatching(bool newLateLatching);
+
+    // In microseconds
+    int renderSafetyMargin() const;
+    void setRenderSafetyMargin(int newRenderSafetyMargin);
+
+    int frameTimingCapacity() const;
+    void setFrameTimingCapacity(int newFrameTimingCapacity);
+
 public Q_SLOTS:
     void render();
     void render(WOutputViewport *output, bool doCommit);
@@ -76,6 +139,11 @@ Q_SIGNALS:
     void outputViewportInitialized(WAYLIB_SERVER_NAMESPACE::WOutputViewport *output);
     void initialized();
     void disableLayersChanged();
+    void lateLatchingChanged();
+    void renderSafetyMarginChanged();
+    void frameTimingCapacityChanged();
+    // Emitted in rendering after the buffers of the frame are committed
+    void outputsCommitted();
     void renderEnd();
     void effectiveDevicePixelRatioChanged(qreal scale);
 
@@ -89,6 +157,8 @@ private:
     friend class WOutputViewport;
     QList<WOutputLayer*> layers(const WOutputViewport *output) const;
     QList<WOutputLayer*> hardwareLayers(const WOutputViewport *output) const;
+    friend class WSGTextureProviderPrivate;
+    WSGTextureCache *textureCache() const;
 };
 
 WAYLIB_SERVER_END_NAMESPACE
@@ -32,17 +32,45 @@ public:
 
     }
 
+    ~CursorTextureProvider() {
+        resetBuffer();
+        clearImageCache();
+    }
+
+    // The buffer and the texture of an image are kept by QImage::cacheKey, the
+    // cursor shape changes and the animated cursors only switch to the cached
+    // texture, don't upload the image again.
     void setImage(const QImage &image) {
         if (image.isNull()) {
             resetBuffer();
             return;
         }
 
-        // WImageBufferImpl destroy following qw_buffer
-        auto buffer = qw_buffer::create(new WImageBufferImpl(image),
-                                       image.width(), image.height());
-        this->buffer.reset(buffer);
-        setBuffer(this->buffer.get());
+        auto it = imageCache.constFind(image.cacheKey());
+        if (it == imageCache.constEnd()) {
+            if (imageCache.size() >= MaxCachedImages) {
+                resetBuffer();
+                clearImageCache();
+            }
+
+            // WImageBufferImpl destroy following qw_buffer
+            auto buffer = qw_buffer::create(new WImageBufferImpl(image),
+                                           image.width(), image.height());
+            auto texture = qw_texture::from_buffer(*window()->renderer(), *buffer);
+            if (!texture) {
+                qw_buffer::droper{}(buffer);
+                resetBuffer();
+                return;
+            }
+
+            it = imageCache.insert(image.cacheKey(), {buffer, texture});
+        }
+
+        if (this->buffer == it->buffer)
+            return;
+
+        this->buffer = it->buffer;
+        setTexture(it->texture, it->buffer);
     }
 
     void setProxy(WSGTextureProvider *proxy) {
@@ -65,8 +93,18 @@ public:
     }
 
     void resetBuffer() {
+        if (!buffer)
+            return;
         setBuffer(nullptr);
-        buffer.reset();
+        buffer = nullptr;
+    }
+    void clearImageCache() {
+        Q_ASSERT(!buffer);
+        for (const auto &i : std::as_const(imageCache)) {
+            delete i.texture;
+            qw_buffer::droper{}(i.buffer);
+        }
+        imageCache.clear();
     }
     void reset() {
         resetBuffer();
@@ -89,7 +127,15 @@ public:
         return WSGTextureProvider::qwBuffer();
     }
 
-    std::unique_ptr<qw_buffer, qw_buffer::droper> buffer;
+    struct CachedImage {
+        qw_buffer *buffer;
+        qw_texture *texture;
+    };
+    // An animated cursor has dozens of frames at most
+    static constexpr int MaxCachedImages = 64;
+    QHash<qint64, CachedImage> imageCache;
+    // The current buffer of the image, it's owned by imageCache
+    qw_buffer *buffer = nullptr;
     QPointer<WSGTextureProvider> proxy;
 };
 
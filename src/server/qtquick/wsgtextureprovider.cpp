@@ -5,6 +5,7 @@
 #include "woutputrenderwindow.h"
 #include "wrenderhelper.h"
 #include "private/wglobal_p.h"
+#include "private/wsgtexturecache_p.h"
 
 #include <qwtexture.h>
 #include <qwbuffer.h>
@@ -66,7 +67,10 @@ public:
 
     void updateRhiTexture() {
         Q_ASSERT(texture);
-        bool ok = WRenderHelper::makeTexture(window->rhi(), texture, &qtTexture);
+        bool isCached = false;
+        bool ok = ownsTexture ? WRenderHelper::makeTexture(window->rhi(), texture, &qtTexture)
+                              : window->textureCache()->makeTexture(window->rhi(), texture,
+                                                                    buffer, &qtTexture, &isCached);
         if (Q_UNLIKELY(!ok)) {
             qCWarning(lcQtQuickTexture) << "Failed to make texture:" << texture
                                         << ", width height:" << texture->handle()->width
@@ -74,7 +78,8 @@ public:
             return;
         }
 
-        rhiTexture = qtTexture.rhiTexture();
+        // The cached texture is owned by the WSGTextureCache
+        rhiTexture = isCached ? nullptr : qtTexture.rhiTexture();
     }
 
     W_DECLARE_PUBLIC(WSGTextureProvider)
@@ -10,6 +10,7 @@
 #include "woutputviewport.h"
 #include "wsgtextureprovider.h"
 #include "woutputrenderwindow.h"
+#include "wsurfacehitindex_p.h"
 
 #include <qwcompositor.h>
 #include <qwsubcompositor.h>
@@ -87,6 +88,10 @@ public:
         setFlag(QQuickItem::ItemClipsChildrenToShape, true);
         setCursor(WCursor::toQCursor(WGlobal::CursorShape::ClientResource));
     }
+    ~EventItem() override {
+        if (m_hitIndex)
+            m_hitIndex->remove(this);
+    }
 
     inline bool isValid() const {
         if (!parent())
@@ -108,6 +113,18 @@ public:
     }
 
 private:
+    void itemChange(ItemChange change, const ItemChangeData &data) override {
+        if (change == ItemSceneChange) {
+            if (m_hitIndex)
+                m_hitIndex->remove(this);
+            m_hitIndex = data.window ? WSurfaceHitIndex::get(data.window) : nullptr;
+            if (m_hitIndex)
+                m_hitIndex->insert(this);
+        }
+
+        QQuickItem::itemChange(change, data);
+    }
+
     bool event(QEvent *event) override {
         switch(event->type()) {
         using enum QEvent::Type;
@@ -149,6 +166,8 @@ private:
 
         return QQuickItem::event(event);
     }
+
+    QPointer<WSurfaceHitIndex> m_hitIndex;
 };
 
 class Q_DECL_HIDDEN WSurfaceItemContentPrivate: public QQuickItemPrivate
@@ -481,6 +500,11 @@ public:
 
     ~WSGRenderFootprintNode() {}
 
+    // Don't paint anything, avoid to damage the whole render target
+    RenderingFlags flags() const override {
+        return BoundedRectRendering;
+    }
+
     void render(const RenderState*) override
     {
         if (Q_LIKELY(m_owner))
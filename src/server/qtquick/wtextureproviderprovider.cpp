@@ -5,12 +5,97 @@
 #include "woutputrenderwindow.h"
 #include "private/wglobal_p.h"
 
+#include <qwbuffer.h>
+
+#include <QMutex>
+#include <QPointer>
 #include <rhi/qrhi.h>
 #include <private/qquickwindow_p.h>
 
+#include <memory>
+#include <vector>
+
+QW_USE_NAMESPACE
 WAYLIB_SERVER_BEGIN_NAMESPACE
 Q_LOGGING_CATEGORY(qLcTextureProvider, "waylib.server.texture.provider")
 
+// The readback results are reused by the captures, a result is in use until the
+// QImage referencing its data is released, the QImage may be released in any thread.
+class Q_DECL_HIDDEN ReadbackPool : public std::enable_shared_from_this<ReadbackPool>
+{
+public:
+    struct Buffer {
+        QRhiReadbackResult result;
+        std::shared_ptr<ReadbackPool> pool;
+        bool completed = false;
+    };
+
+    ~ReadbackPool() {
+        qDeleteAll(freeBuffers);
+    }
+
+    Buffer *acquire() {
+        Buffer *buffer = nullptr;
+        {
+            QMutexLocker locker(&mutex);
+            if (!freeBuffers.isEmpty())
+                buffer = freeBuffers.takeLast();
+        }
+
+        if (!buffer)
+            buffer = new Buffer;
+        buffer->pool = shared_from_this();
+        buffer->completed = false;
+        return buffer;
+    }
+
+    // The QImageCleanupFunction of the captured images
+    static void release(void *data) {
+        // Keep the data of QByteArray to reuse its memory
+        auto buffer = reinterpret_cast<Buffer*>(data);
+        const auto pool = std::move(buffer->pool);
+
+        QMutexLocker locker(&pool->mutex);
+        if (pool->freeBuffers.size() < MaxFreeBuffers) {
+            pool->freeBuffers.append(buffer);
+        } else {
+            locker.unlock();
+            delete buffer;
+        }
+    }
+
+private:
+    static constexpr int MaxFreeBuffers = 3;
+
+    QMutex mutex;
+    QList<Buffer*> freeBuffers;
+};
+
+static QImage::Format toImageFormat(QRhiTexture::Format format)
+{
+    switch (format) {
+    case QRhiTexture::RGBA8:
+        return QImage::Format_RGBA8888_Premultiplied;
+    case QRhiTexture::BGRA8:
+        // The byte order of BGRA8 is ARGB32 in little endian
+        return Q_BYTE_ORDER == Q_LITTLE_ENDIAN ? QImage::Format_ARGB32_Premultiplied
+                                               : QImage::Format_Invalid;
+    case QRhiTexture::R8:
+    case QRhiTexture::RED_OR_ALPHA8:
+        return QImage::Format_Grayscale8;
+    case QRhiTexture::R16:
+        return QImage::Format_Grayscale16;
+    case QRhiTexture::RGBA16F:
+        return QImage::Format_RGBA16FPx4_Premultiplied;
+    case QRhiTexture::RGBA32F:
+        return QImage::Format_RGBA32FPx4_Premultiplied;
+    case QRhiTexture::RGB10A2:
+        return QImage::Format_A2BGR30_Premultiplied;
+    default:
+        return QImage::Format_Invalid;
+    }
+}
+
 class Q_DECL_HIDDEN WTextureCapturerPrivate : public WObjectPrivate
 {
 public:
@@ -21,71 +106,205 @@ public:
         , renderWindow(p->outputRenderWindow())
     {}
 
-    QPromise<QImage> imgPromise;
+    void finish(const QImage &image);
+    void finish(const char *error);
+    void onReadbackCompleted(ReadbackPool::Buffer *buffer);
+
+    // QPromise is move-only, QList requires the copyable type
+    std::vector<QPromise<QImage>> promises;
+    std::shared_ptr<ReadbackPool> readbackPool = std::make_shared<ReadbackPool>();
+    QPointer<WSGTextureProvider> streamingProvider;
+    bool streaming = false;
+    bool captureRequested = false;
+
     WTextureProviderProvider *const provider;
     WOutputRenderWindow *const renderWindow;
 };
 
-static void cleanupRbResult(void *rbResult)
+void WTextureCapturerPrivate::finish(const QImage &image)
+{
+    W_Q(WTextureCapturer);
+
+    for (auto &promise : promises) {
+        if (!promise.isCanceled())
+            promise.addResult(image);
+        promise.finish();
+    }
+    promises.clear();
+
+    // Called in the rendering of the window, don't let the users change the
+    // scene in rendering
+    if (streaming) {
+        QMetaObject::invokeMethod(q, [q, image] {
+            Q_EMIT q->frameCaptured(image);
+        }, Qt::QueuedConnection);
+    }
+}
+
+void WTextureCapturerPrivate::finish(const char *error)
+{
+    for (auto &promise : promises) {
+        promise.setException(std::make_exception_ptr(std::runtime_error(error)));
+        promise.finish();
+    }
+    promises.clear();
+}
+
+void WTextureCapturerPrivate::onReadbackCompleted(ReadbackPool::Buffer *buffer)
 {
-    delete reinterpret_cast<QRhiReadbackResult*>(rbResult);
+    const QRhiReadbackResult &result = buffer->result;
+    const QImage::Format format = toImageFormat(result.format);
+    const QSize size = result.pixelSize;
+
+    if (format == QImage::Format_Invalid || size.isEmpty() || result.data.isEmpty()) {
+        qCWarning(qLcTextureProvider) << "Can't convert the texture of format"
+                                      << result.format << "to QImage";
+        ReadbackPool::release(buffer);
+        finish("Unsupported texture format.");
+        return;
+    }
+
+    // The QImage owns the buffer, the buffer is returned to the pool
+    // when the image is released
+    finish(QImage(reinterpret_cast<const uchar *>(result.data.constData()),
+                  size.width(), size.height(), result.data.size() / size.height(),
+                  format, ReadbackPool::release, buffer));
 }
 
 WTextureCapturer::WTextureCapturer(WTextureProviderProvider *provider, QObject *parent)
     : QObject(parent)
     , WObject(*new WTextureCapturerPrivate(this, provider))
 {
+    W_D(WTextureCapturer);
 
+    // Read back after the outputs are committed, the offscreen frame of the
+    // readback blocks until the GPU finished, it would delay the page flip
+    // if it's in the frame.
+    connect(d->renderWindow, &WOutputRenderWindow::outputsCommitted,
+            this, &WTextureCapturer::capture, Qt::DirectConnection);
+    connect(d->renderWindow, &WOutputRenderWindow::renderEnd, this, [this] {
+        W_D(WTextureCapturer);
+        // Requested after the outputsCommitted of the last frame
+        if (d->captureRequested)
+            d->renderWindow->scheduleRender();
+    });
 }
 
 QFuture<QImage> WTextureCapturer::grabToImage()
 {
     W_D(WTextureCapturer);
-    auto future = d->imgPromise.future();
-    moveToThread(QQuickWindowPrivate::get(d->renderWindow)->context->thread());
-    if (d->renderWindow->inRendering()) {
-        connect(d->renderWindow, &WOutputRenderWindow::renderEnd, this, &WTextureCapturer::doGrabToImage, Qt::AutoConnection);
-    } else {
-        // FIXME What if a new render process start before this job is executed?
-        QMetaObject::invokeMethod(this, &WTextureCapturer::doGrabToImage, Qt::AutoConnection);
-    }
+
+    QPromise<QImage> promise;
+    auto future = promise.future();
+    promise.start();
+    d->promises.push_back(std::move(promise));
+    scheduleCapture();
+
     return future;
 }
 
-void WTextureCapturer::doGrabToImage()
+bool WTextureCapturer::streaming() const
+{
+    W_DC(WTextureCapturer);
+    return d->streaming;
+}
+
+// Capture the texture every time it's changed, the images are sent by frameCaptured
+void WTextureCapturer::setStreaming(bool newStreaming)
 {
     W_D(WTextureCapturer);
-    if (d->imgPromise.isCanceled())
+    if (d->streaming == newStreaming)
         return;
-    d->imgPromise.start();
-    WSGTextureProvider *textureProvider = d->provider->wTextureProvider();
-    if (textureProvider && textureProvider->texture() && textureProvider->texture()->rhiTexture()) {
-        // Perform rhi texture read back
-        auto texture = textureProvider->texture()->rhiTexture();
-        qCInfo(qLcTextureProvider) << "Perform rhi texture read back for texture" << texture;
-        QRhiReadbackResult *rbResult = new QRhiReadbackResult;
-        QRhiCommandBuffer *cb;
-        d->renderWindow->rhi()->beginOffscreenFrame(&cb);
-        auto ub = d->renderWindow->rhi()->nextResourceUpdateBatch();
-        cb->beginComputePass(ub);
-        QRhiReadbackDescription rbd(texture);
-        ub->readBackTexture(rbd, rbResult);
-        cb->endComputePass(ub);
-        auto frameOpResult = d->renderWindow->rhi()->endOffscreenFrame();
-        if (frameOpResult == QRhi::FrameOpSuccess) {
-            d->imgPromise.addResult(QImage(reinterpret_cast<const uchar *>(rbResult->data.constData()),
-                                       rbResult->pixelSize.width(),
-                                       rbResult->pixelSize.height(),
-                                       QImage::Format_RGBA8888_Premultiplied,
-                                       cleanupRbResult,
-                                       rbResult)); // TODO: Automatically get data format.
-        } else {
-            d->imgPromise.setException(std::make_exception_ptr(std::runtime_error("Offscreen frame operation failed.")));
+    d->streaming = newStreaming;
+
+    if (d->streamingProvider) {
+        d->streamingProvider->disconnect(this);
+        d->streamingProvider.clear();
+    }
+
+    if (d->streaming) {
+        d->streamingProvider = d->provider->wTextureProvider();
+        if (d->streamingProvider) {
+            connect(d->streamingProvider, &QSGTextureProvider::textureChanged,
+                    this, &WTextureCapturer::scheduleCapture);
         }
-    } else {
-        d->imgPromise.setException(std::make_exception_ptr(std::runtime_error("Texture provider is not valid.")));
+        scheduleCapture();
     }
-    d->imgPromise.finish();
+
+    Q_EMIT streamingChanged();
+}
+
+// Export the buffer of the texture without copy if it's a dmabuf, returns the
+// buffer locked, or nullptr if failed. The attributes are owned by the buffer,
+// and valid until releaseDmabuf is called with the returned buffer.
+qw_buffer *WTextureCapturer::exportDmabuf(wlr_dmabuf_attributes *attribs) const
+{
+    W_DC(WTextureCapturer);
+    auto textureProvider = d->provider->wTextureProvider();
+    qw_buffer *buffer = textureProvider ? textureProvider->qwBuffer() : nullptr;
+    if (!buffer || !wlr_buffer_get_dmabuf(buffer->handle(), attribs))
+        return nullptr;
+
+    buffer->lock();
+    return buffer;
+}
+
+void WTextureCapturer::releaseDmabuf(qw_buffer *buffer)
+{
+    buffer->unlock();
+}
+
+void WTextureCapturer::scheduleCapture()
+{
+    W_D(WTextureCapturer);
+    d->captureRequested = true;
+    // Capture after the frame in rendering, or request a new frame
+    if (!d->renderWindow->inRendering())
+        d->renderWindow->scheduleRender();
+}
+
+void WTextureCapturer::capture()
+{
+    W_D(WTextureCapturer);
+    if (!d->captureRequested)
+        return;
+    d->captureRequested = false;
+
+    WSGTextureProvider *textureProvider = d->provider->wTextureProvider();
+    QSGTexture *sgTexture = textureProvider ? textureProvider->texture() : nullptr;
+    QRhiTexture *texture = sgTexture ? sgTexture->rhiTexture() : nullptr;
+    QRhi *rhi = d->renderWindow->rhi();
+    if (!texture || !rhi) {
+        d->finish("Texture provider is not valid.");
+        return;
+    }
+
+    QRhiCommandBuffer *cb = nullptr;
+    if (rhi->beginOffscreenFrame(&cb) != QRhi::FrameOpSuccess) {
+        d->finish("Offscreen frame operation failed.");
+        return;
+    }
+
+    qCDebug(qLcTextureProvider) << "Perform rhi texture read back for texture" << texture;
+    auto buffer = d->readbackPool->acquire();
+    // Only mark the buffer here, the buffer may be deleted when it's released,
+    // which destroys this callback, so it's released after endOffscreenFrame
+    buffer->result.completed = [buffer] {
+        buffer->completed = true;
+    };
+
+    auto ub = rhi->nextResourceUpdateBatch();
+    ub->readBackTexture(QRhiReadbackDescription(texture), &buffer->result);
+    cb->resourceUpdate(ub);
+
+    // The readback is completed in endOffscreenFrame
+    if (rhi->endOffscreenFrame() != QRhi::FrameOpSuccess || !buffer->completed) {
+        ReadbackPool::release(buffer);
+        d->finish("Offscreen frame operation failed.");
+        return;
+    }
+
+    d->onReadbackCompleted(buffer);
 }
 
 WAYLIB_SERVER_END_NAMESPACE
@@ -4,6 +4,8 @@
 #pragma once
 
 #include <wsgtextureprovider.h>
+
+struct wlr_dmabuf_attributes;
 WAYLIB_SERVER_BEGIN_NAMESPACE
 class WTextureCapturerPrivate;
 
@@ -18,12 +20,26 @@ class WAYLIB_SERVER_EXPORT WTextureCapturer: public QObject, public WObject
 {
     Q_OBJECT
     W_DECLARE_PRIVATE(WTextureCapturer)
+    Q_PROPERTY(bool streaming READ streaming WRITE setStreaming NOTIFY streamingChanged FINAL)
+
 public:
     explicit WTextureCapturer(WTextureProviderProvider *provider, QObject *parent = nullptr);
+
     QFuture<QImage> grabToImage();
 
+    bool streaming() const;
+    void setStreaming(bool newStreaming);
+
+    QW_NAMESPACE::qw_buffer *exportDmabuf(wlr_dmabuf_attributes *attribs) const;
+    static void releaseDmabuf(QW_NAMESPACE::qw_buffer *buffer);
+
+Q_SIGNALS:
+    void streamingChanged();
+    void frameCaptured(const QImage &image);
+
 private:
-    void doGrabToImage();
+    void scheduleCapture();
+    void capture();
 };
 
 WAYLIB_SERVER_END_NAMESPACE
@@ -483,6 +483,7 @@ public:
     }
 
     void setImage(const QImage &image, const QPoint &hotspot);
+    QImage frameImage(const wlr_xcursor_image *ximage);
     void updateCursorImage();
     void playXCursor();
 
@@ -497,6 +498,12 @@ public:
 
     wlr_xcursor *xcursor = nullptr;
     int currentXCursorImageIndex = 0;
+    // The images of the xcursor frames, they are copied from the xcursor
+    // manager when the cursor shape is used first time, and keep the same
+    // QImage::cacheKey for the frame, so the users of the image can cache
+    // the buffers and the textures by the key. Cleared if the theme or the
+    // scale is changed.
+    QHash<const wlr_xcursor_image*, QImage> frameImages;
     QTimer *xcursorPlayTimer = nullptr;
 
     static thread_local QList<WCursorImagePrivate*> cursorImages;
@@ -510,6 +517,22 @@ void WCursorImagePrivate::setImage(const QImage &image, const QPoint &hotspot) {
     Q_EMIT q_func()->imageChanged();
 }
 
+QImage WCursorImagePrivate::frameImage(const wlr_xcursor_image *ximage)
+{
+    auto it = frameImages.constFind(ximage);
+    if (it != frameImages.constEnd())
+        return it.value();
+
+    // Deep copy, the image must not depend on the memory of the xcursor manager
+    QImage image = QImage(static_cast<const uchar*>(ximage->buffer),
+                          ximage->width, ximage->height,
+                          QImage::Format_ARGB32_Premultiplied).copy();
+    image.setDevicePixelRatio(scale);
+    frameImages.insert(ximage, image);
+
+    return image;
+}
+
 void WCursorImagePrivate::updateCursorImage()
 {
     xcursor = nullptr;
@@ -546,13 +569,14 @@ void WCursorImagePrivate::updateCursorImage()
 
     if (xcursor->image_count == 1) {
         auto ximage = xcursor->images[0];
-        setImage(QImage(static_cast<const uchar*>(ximage->buffer),
-                        ximage->width, ximage->height,
-                        QImage::Format_ARGB32_Premultiplied),
-                 QPoint(ximage->hotspot_x, ximage->hotspot_y));
+        setImage(frameImage(ximage), QPoint(ximage->hotspot_x, ximage->hotspot_y));
         return;
     }
 
+    // Prepare all frames of the animated cursor, avoid to copy in the playing
+    for (uint i = 0; i < xcursor->image_count; ++i)
+        frameImage(xcursor->images[i]);
+
     xcursorPlayTimer = tempTimer.release();
     if (!xcursorPlayTimer) {
         xcursorPlayTimer = new QTimer(q_func());
@@ -573,10 +597,7 @@ void WCursorImagePrivate::playXCursor()
     Q_ASSERT(!xcursorPlayTimer->isActive());
 
     auto ximage = xcursor->images[currentXCursorImageIndex];
-    setImage(QImage(static_cast<const uchar*>(ximage->buffer),
-                    ximage->width, ximage->height,
-                    QImage::Format_ARGB32_Premultiplied),
-             QPoint(ximage->hotspot_x, ximage->hotspot_y));
+    setImage(frameImage(ximage), QPoint(ximage->hotspot_x, ximage->hotspot_y));
 
     currentXCursorImageIndex = (currentXCursorImageIndex + 1) % xcursor->image_count;
     xcursorPlayTimer->start(ximage->delay);
@@ -629,6 +650,7 @@ void WCursorImage::setScale(float newScale)
     if (qFuzzyCompare(d->scale, newScale))
         return;
     d->scale = newScale;
+    d->frameImages.clear();
     if (d->manager)
         d->manager->load(d->scale);
 
@@ -649,6 +671,7 @@ void WCursorImage::setCursorTheme(const QByteArray &name, uint32_t size)
     }
 
     d->manager.reset();
+    d->frameImages.clear();
     for (auto dd : std::as_const(WCursorImagePrivate::cursorImages)) {
         if (dd == d)
             continue;
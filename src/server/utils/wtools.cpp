@@ -12,6 +12,7 @@ extern "C" {
 #include <qcolorspace.h>
 #include <QDebug>
 #include <QQuickItem>
+#include <QVarLengthArray>
 
 #include <pixman.h>
 #include <drm_fourcc.h>
@@ -235,39 +236,41 @@ wl_shm_format_t WTools::drmToShmFormat(uint32_t drmFmt)
 
 QRegion WTools::fromPixmanRegion(pixman_region32 *region)
 {
-    int rectCount = 0;
-    auto rects = pixman_region32_rectangles(region, &rectCount);
-
-    if (!rectCount)
+    int count = 0;
+    const auto rects = pixman_region32_rectangles(region, &count);
+    if (count == 0)
         return {};
+    if (count == 1)
+        return QRegion(QRect(QPoint(rects[0].x1, rects[0].y1), QPoint(rects[0].x2 - 1, rects[0].y2 - 1)));
 
-    QVector<QRect> rectList;
-    rectList.resize(rectCount);
-
-    for (int i = 0; i < rectCount; ++i)
-        rectList[i].setCoords(rects[i].x1, rects[i].y1, rects[i].x2 - 1, rects[i].y2 - 1);
+    QVarLengthArray<QRect, 32> list;
+    list.reserve(count);
+    for (int i = 0; i < count; ++i)
+        list.append(QRect(QPoint(rects[i].x1, rects[i].y1), QPoint(rects[i].x2 - 1, rects[i].y2 - 1)));
 
     QRegion qregion;
-    qregion.setRects(rectList.constData(), rectList.count());
-    Q_ASSERT(qregion.rectCount() == rectList.count());
+    qregion.setRects(list.constData(), list.size());
     return qregion;
 }
 
+// The rectangles of QRegion are sorted by y-x bands like pixman, they can be
+// used to build the pixman region directly. The "pixmanRegion" is initialized
+// here, returns false if failed to allocate the memory.
 bool WTools::toPixmanRegion(const QRegion &region, pixman_region32 *pixmanRegion)
 {
-    QVector<pixman_box32_t> rects;
-    rects.resize(region.rectCount());
-
-    int i = 0;
-    for (const QRect &r : std::as_const(region)) {
-        pixman_box32_t &box = rects[i++];
-        box.x1 = r.x();
-        box.y1 = r.y();
-        box.x2 = r.right() + 1;
-        box.y2 = r.bottom() + 1;
+    if (region.rectCount() <= 1) {
+        const QRect rect = region.boundingRect();
+        pixman_region32_init_rect(pixmanRegion, rect.x(), rect.y(), rect.width(), rect.height());
+        return true;
     }
-    bool ok = pixman_region32_init_rects(pixmanRegion, rects.constData(), rects.count());
-    Q_ASSERT(!ok || pixman_region32_n_rects(pixmanRegion) == rects.count());
+
+    QVarLengthArray<pixman_box32_t, 32> boxes;
+    boxes.reserve(region.rectCount());
+    for (const QRect &r : region)
+        boxes.append({r.x(), r.y(), r.right() + 1, r.bottom() + 1});
+
+    bool ok = pixman_region32_init_rects(pixmanRegion, boxes.constData(), boxes.size());
+    Q_ASSERT(!ok || pixman_region32_n_rects(pixmanRegion) == region.rectCount());
     return ok;
 }
 
@@ -0,0 +1,110 @@
+// Copyright (C) 2024 JiDe Zhang <zhangjide@deepin.org>.
+// SPDX-License-Identifier: Apache-2.0 OR LGPL-3.0-only OR GPL-2.0-only OR GPL-3.0-only
+
+#include <private/winputeventstates_p.h>
+
+#include <QTest>
+#include <QMouseEvent>
+
+#include <memory>
+#include <vector>
+
+WAYLIB_SERVER_USE_NAMESPACE
+
+static std::vector<std::unique_ptr<QMouseEvent>> makeEvents(int count)
+{
+    std::vector<std::unique_ptr<QMouseEvent>> events;
+    events.reserve(count);
+
+    for (int i = 0; i < count; ++i) {
+        auto event = std::make_unique<QMouseEvent>(QEvent::MouseMove, QPointF(i, i), QPointF(i, i),
+                                                   Qt::NoButton, Qt::NoButton, Qt::NoModifier);
+        event->setTimestamp(i);
+        events.push_back(std::move(event));
+    }
+
+    return events;
+}
+
+// Same as WSeat: the before dispose stage, sendEvent of the target surface
+// and the after dispose stage, the inner events are delivered in the middle.
+static void dispatchEvents(WInputEventStates &states, const std::vector<std::unique_ptr<QMouseEvent>> &events, int index)
+{
+    states.push(events[index].get());
+
+    if (index + 1 < int(events.size()))
+        dispatchEvents(states, events, index + 1);
+
+    if (auto state = states.find(events[index].get()))
+        state->isAccepted = true;
+
+    states.pop(states.find(events[index].get()));
+}
+
+class InputEventStatesTest : public QObject
+{
+    Q_OBJECT
+
+private Q_SLOTS:
+    void nested_data()
+    {
+        QTest::addColumn<int>("depth");
+        QTest::newRow("1") << 1;
+        QTest::newRow("2") << 2;
+        QTest::newRow("8") << 8;
+        QTest::newRow("32") << 32;
+    }
+
+    void nested()
+    {
+        QFETCH(int, depth);
+        const auto events = makeEvents(depth);
+        WInputEventStates states;
+
+        for (const auto &event : events)
+            QVERIFY(states.push(event.get()));
+        QCOMPARE(states.size(), qsizetype(depth));
+
+        for (const auto &event : events) {
+            auto state = states.find(event.get());
+            QVERIFY(state);
+            QVERIFY(state->event == event.get());
+            QVERIFY(state->isAccepted);
+        }
+
+        // The same event object is reused with a new timestamp
+        events.front()->setTimestamp(depth);
+        QVERIFY(!states.find(events.front().get()));
+        events.front()->setTimestamp(0);
+
+        // Remove from the middle
+        states.pop(states.find(events.front().get()));
+        QCOMPARE(states.size(), qsizetype(depth - 1));
+        QVERIFY(!states.find(events.front().get()));
+
+        for (auto it = events.rbegin(); it != events.rend() - 1; ++it)
+            states.pop(states.find(it->get()));
+        QCOMPARE(states.size(), qsizetype(0));
+    }
+
+    void dispatch_data()
+    {
+        nested_data();
+    }
+
+    void dispatch()
+    {
+        QFETCH(int, depth);
+        const auto events = makeEvents(depth);
+        WInputEventStates states;
+
+        QBENCHMARK {
+            dispatchEvents(states, events, 0);
+        }
+
+        QCOMPARE(states.size(), qsizetype(0));
+    }
+};
+
+QTEST_MAIN(InputEventStatesTest)
+#include "main.moc"
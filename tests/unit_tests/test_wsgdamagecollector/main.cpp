@@ -0,0 +1,75 @@
+// Copyright (C) 2024 JiDe Zhang <zhangjide@deepin.org>.
+// SPDX-License-Identifier: Apache-2.0 OR LGPL-3.0-only OR GPL-2.0-only OR GPL-3.0-only
+
+#include <wsgdamagecollector_p.h>
+
+#include <QTest>
+#include <QSGNode>
+#include <QSGFlatColorMaterial>
+
+WAYLIB_SERVER_USE_NAMESPACE
+
+static QSGGeometryNode *createRectNode(const QRectF &rect)
+{
+    auto geometry = new QSGGeometry(QSGGeometry::defaultAttributes_Point2D(), 4);
+    QSGGeometry::updateRectGeometry(geometry, rect);
+
+    auto node = new QSGGeometryNode;
+    node->setGeometry(geometry);
+    node->setMaterial(new QSGFlatColorMaterial);
+    node->setFlags(QSGNode::OwnsGeometry | QSGNode::OwnsMaterial);
+    return node;
+}
+
+static QRectF boundingRect(const QList<QRectF> &rects)
+{
+    QRectF rect;
+    for (const QRectF &r : rects)
+        rect |= r;
+    return rect;
+}
+
+class DamageCollectorTest : public QObject
+{
+    Q_OBJECT
+
+private Q_SLOTS:
+    // Every WSurfaceItem clips its children by a rectangular clip node, the
+    // changes in a clipped subtree must not damage the whole scene, otherwise
+    // the WBufferRenderer never repaints partially.
+    void clippedSubtree()
+    {
+        QSGRootNode root;
+        auto clip = new QSGClipNode;
+        clip->setIsRectangular(true);
+        clip->setClipRect(QRectF(0, 0, 100, 100));
+        auto transform = new QSGTransformNode;
+        QMatrix4x4 matrix;
+        matrix.translate(200, 100);
+        transform->setMatrix(matrix);
+        auto node = createRectNode(QRectF(10, 10, 20, 20));
+
+        root.appendChildNode(transform);
+        transform->appendChildNode(clip);
+        clip->appendChildNode(node);
+
+        WSGDamageCollector collector(&root);
+        QList<QRectF> rects;
+        QVERIFY(collector.takeDamage(&rects));
+        QCOMPARE(boundingRect(rects), QRectF(210, 110, 20, 20));
+        QVERIFY(!collector.hasDamage());
+
+        QSGGeometry::updateRectGeometry(node->geometry(), QRectF(40, 40, 20, 20));
+        node->markDirty(QSGNode::DirtyGeometry);
+        QVERIFY(collector.hasDamage());
+
+        rects.clear();
+        QVERIFY(collector.takeDamage(&rects));
+        QVERIFY(!collector.hasUnboundedNode());
+        // The old and the new bounds of the node
+        QCOMPARE(boundingRect(rects), QRectF(210, 110, 50, 50));
+    }
+};
+
+QTEST_MAIN(DamageCollectorTest)
+#include "main.moc"
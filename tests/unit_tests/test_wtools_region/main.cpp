@@ -0,0 +1,170 @@
+// Copyright (C) 2024 JiDe Zhang <zhangjide@deepin.org>.
+// SPDX-License-Identifier: Apache-2.0 OR LGPL-3.0-only OR GPL-2.0-only OR GPL-3.0-only
+
+#include <wtools.h>
+#include <wpixmanregion_p.h>
+
+#include <QTest>
+#include <QtMath>
+
+#include <pixman.h>
+
+WAYLIB_SERVER_USE_NAMESPACE
+
+// Make a region of "count" rectangles, the rectangles are not adjacent
+static QRegion makeRegion(int count)
+{
+    const int columns = qCeil(qSqrt(count));
+    QVector<QRect> rects;
+    rects.reserve(count);
+
+    for (int i = 0; i < count; ++i)
+        rects.append(QRect((i % columns) * 20, (i / columns) * 20, 10, 10));
+
+    QRegion region;
+    region.setRects(rects.constData(), rects.size());
+    return region;
+}
+
+class RegionTest : public QObject
+{
+    Q_OBJECT
+
+private Q_SLOTS:
+    void roundTrip_data()
+    {
+        QTest::addColumn<int>("count");
+        QTest::newRow("0") << 0;
+        QTest::newRow("1") << 1;
+        QTest::newRow("10") << 10;
+        QTest::newRow("100") << 100;
+        QTest::newRow("1000") << 1000;
+    }
+
+    void roundTrip()
+    {
+        QFETCH(int, count);
+        const QRegion region = makeRegion(count);
+        QCOMPARE(region.rectCount(), count);
+
+        pixman_region32_t pixmanRegion;
+        QVERIFY(WTools::toPixmanRegion(region, &pixmanRegion));
+        QCOMPARE(pixman_region32_n_rects(&pixmanRegion), count);
+        QCOMPARE(WTools::fromPixmanRegion(&pixmanRegion), region);
+        pixman_region32_fini(&pixmanRegion);
+    }
+
+    void toPixmanRegion_data()
+    {
+        QTest::addColumn<int>("count");
+        QTest::newRow("1") << 1;
+        QTest::newRow("10") << 10;
+        QTest::newRow("100") << 100;
+        QTest::newRow("1000") << 1000;
+    }
+
+    void toPixmanRegion()
+    {
+        QFETCH(int, count);
+        const QRegion region = makeRegion(count);
+
+        QBENCHMARK {
+            pixman_region32_t pixmanRegion;
+            WTools::toPixmanRegion(region, &pixmanRegion);
+            pixman_region32_fini(&pixmanRegion);
+        }
+    }
+
+    void fromPixmanRegion_data()
+    {
+        toPixmanRegion_data();
+    }
+
+    void fromPixmanRegion()
+    {
+        QFETCH(int, count);
+        pixman_region32_t pixmanRegion;
+        QVERIFY(WTools::toPixmanRegion(makeRegion(count), &pixmanRegion));
+
+        QBENCHMARK {
+            const QRegion region = WTools::fromPixmanRegion(&pixmanRegion);
+            Q_UNUSED(region);
+        }
+
+        pixman_region32_fini(&pixmanRegion);
+    }
+
+    void unite_data()
+    {
+        toPixmanRegion_data();
+    }
+
+    void unite()
+    {
+        QFETCH(int, count);
+        const WPixmanRegion region(makeRegion(count));
+        // Overlap the half of every rectangle
+        WPixmanRegion other(region);
+        other.translate(QPoint(5, 5));
+
+        QBENCHMARK {
+            WPixmanRegion result(region);
+            result.unite(other);
+        }
+    }
+
+    void intersect_data()
+    {
+        toPixmanRegion_data();
+    }
+
+    void intersect()
+    {
+        QFETCH(int, count);
+        const WPixmanRegion region(makeRegion(count));
+        WPixmanRegion other(region);
+        other.translate(QPoint(5, 5));
+
+        QBENCHMARK {
+            WPixmanRegion result(region);
+            result.intersect(other);
+        }
+    }
+
+    void scale_data()
+    {
+        QTest::addColumn<int>("count");
+        QTest::addColumn<qreal>("scale");
+        QTest::newRow("1@1.25") << 1 << 1.25;
+        QTest::newRow("10@1.25") << 10 << 1.25;
+        QTest::newRow("100@1.25") << 100 << 1.25;
+        QTest::newRow("1000@1.25") << 1000 << 1.25;
+        QTest::newRow("1000@2") << 1000 << 2.0;
+    }
+
+    void scale()
+    {
+        QFETCH(int, count);
+        QFETCH(qreal, scale);
+        const WPixmanRegion region(makeRegion(count));
+
+        // The scaled region covers the scaled source area
+        WPixmanRegion scaled(region);
+        scaled.scale(scale);
+        for (const QRect &r : region) {
+            const QRect expected = QRectF(r.x() * scale, r.y() * scale,
+                                          r.width() * scale, r.height() * scale).toAlignedRect();
+            WPixmanRegion covered(expected);
+            covered.subtract(scaled);
+            QVERIFY(covered.isEmpty());
+        }
+
+        QBENCHMARK {
+            WPixmanRegion result(region);
+            result.scale(scale);
+        }
+    }
+};
+
+QTEST_MAIN(RegionTest)
+#include "main.moc"